@@ -15,7 +15,9 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include <float.h>
 #include <assert.h>
 #include <vector>
@@ -26,16 +28,27 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "curve.h"
 #include "widgets.h"
 #include "curvefile.h"
+#include "curvebin.h"
+#include "nurbs.h"
+#include "bvh.h"
+#include "pointindex.h"
+#include "threadpool.h"
+#include "scenetess.h"
+#include "stroke.h"
 
 int win_width, win_height;
 float win_aspect;
 
 static void draw_grid(float sz, float sep, float alpha = 1.0f);
 static void draw_curve(const Curve *curve);
+static void draw_nurbs(const Nurbs *nurbs);
+static void draw_strip(const std::vector<Vector2> &strip);
+static void update_tessellation();
 static void draw_bgimage(float sz, float alpha = 1.0f);
 static void on_click(int bn, float u, float v);
 static int curve_index(const Curve *curve);
 static Vector2 snap(const Vector2 &p);
+static void tune_point_index();
 
 // viewport control
 static Vector2 view_pan;
@@ -48,7 +61,16 @@ static CurveType curve_type = CURVE_HERMITE;
 
 static bool show_bounds;
 
+// curve flattening tolerance, in pixels or world units
+static float tess_tol = 0.25f;
+static bool tess_tol_pixels = true;
+static int num_tess_verts, num_fixed_verts;	// vertex count stats of the last frame
+
 static std::vector<Curve*> curves;
+static std::vector<Nurbs*> nurbs;	// nurbs curves loaded from files (not editable)
+static CurveBVH curve_bvh;	// spatial index of curves, for hit testing
+static PointIndex point_index;	// all control points, for snapping and point picking
+static float point_spacing;	// average spacing of the points of the last loaded file
 static Curve *sel_curve;	// selected curve being edited
 static Curve *new_curve;	// new curve being entered
 static Curve *hover_curve;	// curve the mouse is hovering over (click to select)
@@ -70,6 +92,8 @@ static void *type_change_callback_cls;
 static void (*showbbox_callback)(bool, void*);
 static void *showbbox_callback_cls;
 
+static ThreadPool *pool;
+
 
 bool app_init(int argc, char **argv)
 {
@@ -83,12 +107,17 @@ bool app_init(int argc, char **argv)
 
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	pool = new ThreadPool;
+	tune_point_index();
 	return true;
 }
 
 void app_cleanup()
 {
 	app_tool_clear();
+	delete pool;
+	pool = 0;
 }
 
 void app_draw()
@@ -108,6 +137,12 @@ void app_draw()
 	float max_aspect = std::max(win_aspect, 1.0f / win_aspect);
 	draw_grid(max_aspect, grid_size);
 
+	update_tessellation();
+
+	num_tess_verts = num_fixed_verts = 0;
+	for(size_t i=0; i<nurbs.size(); i++) {
+		draw_nurbs(nurbs[i]);
+	}
 	for(size_t i=0; i<curves.size(); i++) {
 		draw_curve(curves[i]);
 	}
@@ -178,14 +213,63 @@ static void draw_grid(float sz, float sep, float alpha)
 
 }
 
+// world-space size of a pixel
+static float pixel_size()
+{
+	return 2.0f / ((float)win_height * view_scale);
+}
+
+static float tess_tolerance()
+{
+	if(tess_tol_pixels) {
+		float tol = tess_tol * pixel_size();
+		/* round down to a power of two, so that the cached tessellations
+		 * aren't invalidated by every little change of the zoom level
+		 */
+		return exp2(floor(log2(tol)));
+	}
+	return tess_tol;
+}
+
+/* re-tessellate all curves whose cached tessellation is out of date, in
+ * parallel, before drawing them.
+ */
+static void update_tessellation()
+{
+	static std::vector<Curve*> dirty;
+	static std::vector<std::vector<Vector3> > verts;
+
+	float tol = tess_tolerance();
+
+	dirty.clear();
+	for(size_t i=0; i<curves.size(); i++) {
+		if(!curves[i]->has_tessellation(tol)) {
+			dirty.push_back(curves[i]);
+		}
+	}
+	if(new_curve && !new_curve->has_tessellation(tol)) {
+		dirty.push_back(new_curve);
+	}
+	if(dirty.empty()) return;
+
+	int num = (int)dirty.size();
+	if((int)verts.size() < num) {
+		verts.resize(num);
+	}
+	tessellate_scene(pool, &dirty[0], num, tol, &verts[0]);
+
+	for(int i=0; i<num; i++) {
+		dirty[i]->set_tessellation(tol, &verts[i]);
+	}
+}
+
 static void draw_curve(const Curve *curve)
 {
 	int numpt = curve->size();
-	int segm = numpt * 16;
 
 	if(show_bounds) {
 		Vector3 bmin, bmax;
-		curve->get_bbox(&bmin, &bmax);
+		curve->get_curve_bbox(&bmin, &bmax);
 
 		glLineWidth(1.0);
 		glColor3f(0, 1, 0);
@@ -197,7 +281,6 @@ static void draw_curve(const Curve *curve)
 		glEnd();
 	}
 
-	glLineWidth(curve == hover_curve ? 4.0 : 2.0);
 	if(curve == sel_curve) {
 		glColor3f(0.3, 0.4, 1.0);
 	} else if(curve == new_curve) {
@@ -205,14 +288,18 @@ static void draw_curve(const Curve *curve)
 	} else {
 		glColor3f(0.6, 0.6, 0.6);
 	}
-	glBegin(GL_LINE_STRIP);
-	for(int i=0; i<segm; i++) {
-		float t = (float)i / (float)(segm - 1);
-		Vector3 v = curve->interpolate(t);
-		glVertex2f(v.x, v.y);
-	}
-	glEnd();
-	glLineWidth(1.0);
+	float tol = tess_tolerance();
+	num_tess_verts += (int)curve->get_tessellation(tol).size();
+	num_fixed_verts += numpt * 16;
+
+	// stroke on the cpu instead of relying on wide lines
+	static std::vector<Vector2> strip;
+	StrokeStyle style((curve == hover_curve ? 4.0f : 2.0f) * pixel_size());
+	style.round_tol = tol;
+
+	strip.clear();
+	stroke_curve(curve, tol, style, &strip);
+	draw_strip(strip);
 
 	glPointSize(curve == hover_curve ? 10.0 : 7.0);
 	glBegin(GL_POINTS);
@@ -247,6 +334,43 @@ static void draw_curve(const Curve *curve)
 	glPointSize(1.0);
 }
 
+static void draw_nurbs(const Nurbs *nurbs)
+{
+	static std::vector<Vector2> strip;
+
+	if(!nurbs->is_valid()) return;
+
+	float tol = tess_tolerance();
+	const std::vector<Vector3> &verts = nurbs->get_tessellation(tol);
+	num_tess_verts += (int)verts.size();
+	num_fixed_verts += nurbs->num_spans() * 16 + 1;
+
+	StrokeStyle style(2.0f * pixel_size());
+	style.round_tol = tol;
+
+	glColor3f(0.5, 0.5, 0.5);
+	strip.clear();
+	stroke_polyline(&verts[0], (int)verts.size(), style, &strip);
+	draw_strip(strip);
+}
+
+// draw a triangle strip made by the stroker, in the current color
+static void draw_strip(const std::vector<Vector2> &strip)
+{
+	if(strip.empty()) return;
+
+	// the winding of the strip triangles isn't consistent
+	glPushAttrib(GL_ENABLE_BIT);
+	glDisable(GL_CULL_FACE);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(2, GL_FLOAT, sizeof strip[0], &strip[0]);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, (int)strip.size());
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	glPopAttrib();
+}
+
 void draw_bgimage(float sz, float alpha)
 {
 	glPushAttrib(GL_ENABLE_BIT);
@@ -294,6 +418,7 @@ void app_keyboard(int key, bool pressed)
 
 		case 27:
 			if(new_curve) {
+				point_index.remove(new_curve);
 				delete new_curve;
 				new_curve = 0;
 				post_redisplay();
@@ -320,15 +445,32 @@ void app_keyboard(int key, bool pressed)
 		case 'N':
 			if(sel_curve) {
 				sel_curve->normalize();
+				curve_bvh.update(sel_curve);
+				point_index.update(sel_curve);
 				post_redisplay();
 			}
 			break;
 
+		case 'r':
+		case 'R':
+			app_tool_simplify();
+			break;
+
 		case 'e':
 		case 'E':
 			app_tool_save("test.curves");
 			break;
 
+		case 'x':
+		case 'X':
+			app_tool_export_bezier("test.bezier");
+			break;
+
+		case 'k':
+		case 'K':
+			app_tool_bake("test.cbak");
+			break;
+
 		case 'l':
 		case 'L':
 			if(app_tool_load("test.curves")) {
@@ -342,6 +484,11 @@ void app_keyboard(int key, bool pressed)
 				post_redisplay();
 			}
 			break;
+
+		case 't':
+		case 'T':
+			printf("tessellation: %d vertices (fixed sampling: %d)\n", num_tess_verts, num_fixed_verts);
+			break;
 		}
 	}
 
@@ -421,20 +568,39 @@ void app_mouse_button(int bn, bool pressed, int x, int y)
 
 #define HIT_TEST_THRES	(0.02 / view_scale)
 
-static bool point_hit_test(const Vector2 &pos, Curve **curveret, int *pidxret)
+// point query filters: skip the new curve, or just its last (floating) point
+static bool ignore_new_curve(const Curve *curve, int idx, void *cls)
 {
-	float thres = HIT_TEST_THRES;
+	return curve == new_curve;
+}
 
-	for(size_t i=0; i<curves.size(); i++) {
-		int pidx = curves[i]->nearest_point(pos);
-		if(pidx == -1) continue;
-
-		Vector2 cp = curves[i]->get_point2(pidx);
-		if((cp - pos).length_sq() < thres * thres) {
-			*curveret = curves[i];
-			*pidxret = pidx;
-			return true;
-		}
+static bool ignore_new_curve_last(const Curve *curve, int idx, void *cls)
+{
+	return curve == new_curve && idx == new_curve->size() - 1;
+}
+
+/* size the point index cells to the pick radius, so that a pick touches at
+ * most 4 cells, but not much smaller than the average spacing of the points,
+ * or unbounded snapping queries would walk lots of empty cells. The index is
+ * only rebuilt when the size is off by more than a factor of 2, so zooming
+ * doesn't re-insert all points on every step.
+ */
+static void tune_point_index()
+{
+	float sz = std::max((float)(2.0 * HIT_TEST_THRES), point_spacing);
+	float cur = point_index.get_cell_size();
+	if(sz > cur * 2.0f || sz < cur * 0.5f) {
+		point_index.set_cell_size(sz);
+	}
+}
+
+static bool point_hit_test(const Vector2 &pos, Curve **curveret, int *pidxret)
+{
+	PointRef pt;
+	if(point_index.nearest(pos, &pt, HIT_TEST_THRES, ignore_new_curve)) {
+		*curveret = pt.curve;
+		*pidxret = pt.idx;
+		return true;
 	}
 	*curveret = 0;
 	*pidxret = -1;
@@ -444,23 +610,26 @@ static bool point_hit_test(const Vector2 &pos, Curve **curveret, int *pidxret)
 static bool hit_test(const Vector2 &pos, Curve **curveret, int *pidxret)
 {
 	float thres = HIT_TEST_THRES;
+	float best_dsq = thres * thres;
 
 	if(point_hit_test(pos, curveret, pidxret)) {
 		return true;
 	}
 
 	Vector3 pos3 = Vector3(pos.x, pos.y, 0.0f);
-	for(size_t i=0; i<curves.size(); i++) {
-		float x;
-		if((x = curves[i]->distance_sq(pos3)) < thres * thres) {
-			*curveret = curves[i];
-			*pidxret = -1;
-			return true;
+	static std::vector<Curve*> cand;
+	cand.clear();
+	curve_bvh.query(pos3, thres, &cand);
+
+	for(size_t i=0; i<cand.size(); i++) {
+		float dsq = cand[i]->distance_sq(pos3);
+		if(dsq < best_dsq) {
+			best_dsq = dsq;
+			*curveret = cand[i];
 		}
 	}
-	*curveret = 0;
 	*pidxret = -1;
-	return false;
+	return *curveret != 0;
 }
 
 static Vector2 snap(const Vector2 &p)
@@ -470,37 +639,10 @@ static Vector2 snap(const Vector2 &p)
 		return Vector2(round(p.x / grid_size) * grid_size, round(p.y / grid_size) * grid_size);
 	case SNAP_POINT:
 		{
-			Curve *nearest_curve = 0;
-			int nearest_curve_pidx = -1;
-			float nearest_dist_sq = FLT_MAX;
-
-			if(new_curve) {
-				// find the closest point, ignoring the last
-				for(int i=0; i<new_curve->size() - 1; i++) {
-					Vector2 cp = new_curve->get_point(i);
-					float distsq = (cp - p).length_sq();
-					if(distsq < nearest_dist_sq) {
-						nearest_curve = new_curve;
-						nearest_dist_sq = distsq;
-						nearest_curve_pidx = i;
-					}
-				}
-			}
-
-
-			for(size_t i=0; i<curves.size(); i++) {
-				int pidx = curves[i]->nearest_point(p);
-				Vector2 cp = curves[i]->get_point(pidx);
-				float dist_sq = (cp - p).length_sq();
-				if(dist_sq < nearest_dist_sq) {
-					nearest_curve = curves[i];
-					nearest_curve_pidx = pidx;
-					nearest_dist_sq = dist_sq;
-				}
-			}
-
-			if(nearest_curve) {
-				return nearest_curve->get_point(nearest_curve_pidx);
+			// find the closest point, ignoring the one following the mouse
+			PointRef pt;
+			if(point_index.nearest(p, &pt, -1.0f, ignore_new_curve_last)) {
+				return pt.curve->get_point2(pt.idx);
 			}
 		}
 		break;
@@ -531,6 +673,7 @@ void app_mouse_motion(int x, int y)
 	 */
 	if(new_curve) {
 		new_curve->move_point(new_curve->size() - 1, snap(uv));
+		point_index.update_point(new_curve, new_curve->size() - 1);
 		post_redisplay();
 	}
 
@@ -551,6 +694,8 @@ void app_mouse_motion(int x, int y)
 			if(bnstate & BNBIT(0)) {
 				// dragging point with left button: move it
 				sel_curve->move_point(sel_pidx, snap(uv));
+				curve_bvh.update(sel_curve);
+				point_index.update_point(sel_curve, sel_pidx);
 				post_redisplay();
 			}
 
@@ -560,6 +705,7 @@ void app_mouse_motion(int x, int y)
 				w -= dy * 0.01;
 				if(w < FLT_MIN) w = FLT_MIN;
 				sel_curve->set_weight(sel_pidx, w);
+				curve_bvh.update(sel_curve);
 
 				// popup floating weight label if not already there
 				if(!weight_label) {
@@ -583,6 +729,7 @@ void app_mouse_motion(int x, int y)
 				// zooming
 				view_scale -= ((float)dy / (float)win_height) * view_scale * 5.0;
 				if(view_scale < 1e-4) view_scale = 1e-4;
+				tune_point_index();
 				calc_view_matrix();
 				post_redisplay();
 			}
@@ -594,6 +741,7 @@ void app_mouse_wheel(int rot)
 {
 	view_scale += (float)rot * view_scale * 0.025;
 	if(view_scale < 1e-4) view_scale = 1e-4;
+	tune_point_index();
 	calc_view_matrix();
 	post_redisplay();
 }
@@ -617,17 +765,21 @@ static void on_click(int bn, float u, float v)
 			if(proj_t >= 0.0 && proj_t < 1.0) {
 				// insert somewhere in the middle
 				sel_curve->insert_point(sel_curve->interpolate(proj_t));
+				curve_bvh.update(sel_curve);
+				point_index.update(sel_curve);
 			} else {
 				// enter new curve mode and start appending more points
 				int cidx = curve_index(sel_curve);
 				assert(cidx != -1);
 				curves.erase(curves.begin() + cidx);
+				curve_bvh.remove(sel_curve);
 
 				new_curve = sel_curve;
 				sel_curve = 0;
 				sel_pidx = -1;
 
 				new_curve->add_point(uv);
+				point_index.update(new_curve);
 			}
 		} else {
 			// otherwise, click starts a new curve
@@ -635,8 +787,10 @@ static void on_click(int bn, float u, float v)
 				new_curve = new Curve;
 				new_curve->set_type(curve_type);
 				new_curve->add_point(uv);
+				point_index.add(new_curve);
 			}
 			new_curve->add_point(uv);
+			point_index.update(new_curve);
 		}
 		post_redisplay();
 		break;
@@ -646,9 +800,12 @@ static void on_click(int bn, float u, float v)
 			// in new-curve mode: finish curve (cancels last floating segment)
 			new_curve->remove_point(new_curve->size() - 1);
 			if(new_curve->empty()) {
+				point_index.remove(new_curve);
 				delete new_curve;
 			} else {
 				curves.push_back(new_curve);
+				curve_bvh.add(new_curve);
+				point_index.update(new_curve);
 			}
 			new_curve = 0;
 
@@ -659,11 +816,15 @@ static void on_click(int bn, float u, float v)
 			if(hit_test(uv, &hit_curve, &hit_pidx) && hit_curve == sel_curve) {
 				if(hit_pidx != -1) {
 					hit_curve->remove_point(hit_pidx);
+					curve_bvh.update(hit_curve);
+					point_index.update(hit_curve);
 					sel_pidx = -1;
 					if(hit_curve->empty()) {	// removed the last point
 						int cidx = curve_index(sel_curve);
 						assert(cidx != -1);
 						curves.erase(curves.begin() + cidx);
+						curve_bvh.remove(sel_curve);
+						point_index.remove(sel_curve);
 						delete sel_curve;
 						sel_curve = 0;
 						sel_pidx = -1;
@@ -700,6 +861,12 @@ void app_tool_clear()
 		delete curves[i];
 	}
 	curves.clear();
+	for(size_t i=0; i<nurbs.size(); i++) {
+		delete nurbs[i];
+	}
+	nurbs.clear();
+	curve_bvh.clear();
+	point_index.clear();
 	delete new_curve;
 	sel_curve = new_curve = hover_curve = 0;
 	sel_pidx = -1;
@@ -708,27 +875,56 @@ void app_tool_clear()
 
 bool app_tool_load(const char *fname)
 {
-	std::list<Curve*> clist = load_curves(fname);
-	if(clist.empty()) {
+	std::list<Nurbs*> nlist;
+	std::list<Curve*> clist = load_curves(fname, &nlist);
+	if(clist.empty() && nlist.empty()) {
 		fprintf(stderr, "failed to load curves from: %s\n", fname);
 		return false;
 	}
 
 	app_tool_clear();
 
-	int num = 0;
+	int num = 0, npoints = 0;
+	Vector2 bmin = Vector2(FLT_MAX, FLT_MAX);
+	Vector2 bmax = -bmin;
 	std::list<Curve*>::iterator it = clist.begin();
 	while(it != clist.end()) {
-		curves.push_back(*it++);
+		Curve *c = *it++;
+		int sz = c->size();
+		for(int i=0; i<sz; i++) {
+			Vector2 p = c->get_point2(i);
+			bmin.x = std::min(bmin.x, p.x);
+			bmin.y = std::min(bmin.y, p.y);
+			bmax.x = std::max(bmax.x, p.x);
+			bmax.y = std::max(bmax.y, p.y);
+		}
+		npoints += sz;
+
+		point_index.add(c);
+		curves.push_back(c);
 		++num;
 	}
-	printf("imported %d curves from %s\n", num, fname);
+	point_spacing = npoints ? sqrt((bmax.x - bmin.x) * (bmax.y - bmin.y) / npoints) : 0.0f;
+	tune_point_index();
+	curve_bvh.build(curves.empty() ? 0 : &curves[0], (int)curves.size());
+	nurbs.assign(nlist.begin(), nlist.end());
+	printf("imported %d curves and %d nurbs curves from %s\n", num, (int)nurbs.size(), fname);
 	return true;
 }
 
 bool app_tool_save(const char *fname)
 {
-	if(!save_curves(fname, &curves[0], (int)curves.size())) {
+	const Curve * const *cptr = curves.empty() ? 0 : &curves[0];
+	const Nurbs * const *nptr = nurbs.empty() ? 0 : &nurbs[0];
+	const char *suffix = strrchr(fname, '.');
+
+	bool res;
+	if(suffix && strcmp(suffix, ".curvesb") == 0) {
+		res = save_curves_bin(fname, cptr, (int)curves.size(), nptr, (int)nurbs.size());
+	} else {
+		res = save_curves(fname, cptr, (int)curves.size(), nptr, (int)nurbs.size());
+	}
+	if(!res) {
 		fprintf(stderr, "failed to export curves to %s\n", fname);
 		return false;
 	}
@@ -736,6 +932,39 @@ bool app_tool_save(const char *fname)
 	return true;
 }
 
+bool app_tool_export_bezier(const char *fname)
+{
+	if(!save_bezier(fname, curves.empty() ? 0 : &curves[0], (int)curves.size())) {
+		fprintf(stderr, "failed to export bezier curves to %s\n", fname);
+		return false;
+	}
+	printf("exported %d curves to %s in bezier form\n", (int)curves.size(), fname);
+	return true;
+}
+
+bool app_tool_bake(const char *fname, int samples, BakeFormat fmt, BakeSpacing spacing)
+{
+	std::vector<BakedCurve> baked;
+	float max_err = 0.0f;
+
+	for(size_t i=0; i<curves.size(); i++) {
+		BakedCurve bc;
+		if(!bake_curve(curves[i], samples, spacing, fmt, 2, &bc)) {
+			continue;	// empty curve
+		}
+		max_err = std::max(max_err, bc.max_error);
+		baked.push_back(bc);
+	}
+
+	if(!save_baked(fname, baked.empty() ? 0 : &baked[0], (int)baked.size())) {
+		fprintf(stderr, "failed to bake curves to %s\n", fname);
+		return false;
+	}
+	printf("baked %d curves to %s, %d samples each, max error: %g\n", (int)baked.size(),
+			fname, samples, max_err);
+	return true;
+}
+
 bool app_tool_bgimage(const char *fname)
 {
 	int width, height;
@@ -779,6 +1008,7 @@ CurveType app_tool_type(CurveType type)
 
 	if(sel_curve) {
 		sel_curve->set_type(type);
+		curve_bvh.update(sel_curve);
 		post_redisplay();
 	}
 	if(new_curve) {
@@ -795,6 +1025,7 @@ CurveType app_tool_type(CurveType type)
 void app_tool_delete()
 {
 	if(new_curve) {
+		point_index.remove(new_curve);
 		delete new_curve;
 		new_curve = 0;
 		post_redisplay();
@@ -802,6 +1033,8 @@ void app_tool_delete()
 		int cidx = curve_index(sel_curve);
 		assert(cidx != -1);
 		curves.erase(curves.begin() + cidx);
+		curve_bvh.remove(sel_curve);
+		point_index.remove(sel_curve);
 
 		delete sel_curve;
 		sel_curve = 0;
@@ -810,6 +1043,42 @@ void app_tool_delete()
 	}
 }
 
+float app_tool_simplify(float tol, bool pixels)
+{
+	if(pixels) {
+		tol *= pixel_size();
+	}
+
+	int num_before = 0, num_after = 0;
+	for(size_t i=0; i<curves.size(); i++) {
+		Curve *curve = curves[i];
+		if(sel_curve && curve != sel_curve) continue;
+
+		num_before += curve->size();
+		curve->simplify(tol);
+		num_after += curve->size();
+
+		curve_bvh.update(curve);
+		point_index.update(curve);
+	}
+	if(!num_before) return 0.0f;
+
+	sel_pidx = hover_pidx = -1;
+	post_redisplay();
+
+	float ratio = 1.0f - (float)num_after / (float)num_before;
+	printf("simplified: %d -> %d control points (%.1f%% removed)\n", num_before, num_after,
+			ratio * 100.0f);
+	return ratio;
+}
+
+void app_tool_tess_tolerance(float tol, bool pixels)
+{
+	tess_tol = tol;
+	tess_tol_pixels = pixels;
+	post_redisplay();
+}
+
 void app_tool_showbbox(bool show)
 {
 	show_bounds = show;
@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define APP_H_
 
 #include "curve.h"
+#include "curvebake.h"
 
 enum SnapMode {
 	SNAP_NONE,
@@ -42,12 +43,25 @@ void app_mouse_wheel(int rot);
 
 void app_tool_clear();
 bool app_tool_load(const char *fname);
+// saves in the binary format if the file name ends in .curvesb
 bool app_tool_save(const char *fname);
+// export all curves in piecewise cubic bezier form (see save_bezier)
+bool app_tool_export_bezier(const char *fname);
+// bake all curves into sample tables for playback (see bake_curve)
+bool app_tool_bake(const char *fname, int samples = 256, BakeFormat fmt = BAKE_FIXED16,
+		BakeSpacing spacing = BAKE_ARC_LENGTH);
 bool app_tool_bgimage(const char *fname);
 SnapMode app_tool_snap(SnapMode s);
 CurveType app_tool_type(CurveType type);
 void app_tool_delete();
+/* remove control points from the selected curve (all curves if none is
+ * selected), keeping them within tol pixels (or world units) of the originals.
+ * Returns the fraction of the control points removed.
+ */
+float app_tool_simplify(float tol = 1.0f, bool pixels = true);
 void app_tool_showbbox(bool show);
+// curve flattening tolerance, in pixels if pixels is true, otherwise in world units
+void app_tool_tess_tolerance(float tol, bool pixels = true);
 
 void app_tool_snap_callback(void (*func)(SnapMode, void*), void *cls = 0);
 void app_tool_type_callback(void (*func)(CurveType, void*), void *cls = 0);
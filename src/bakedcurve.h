@@ -0,0 +1,248 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* Header-only reader for baked curve tables (see curvebake.h), for programs
+ * which just want to play back curves. Plain C (or C++), no dependencies.
+ *
+ * Load the whole file in memory (or map it), then:
+ *
+ *	struct baked_curve bc;
+ *	if(baked_get_curve(buf, size, 0, &bc) == 0) {
+ *		float pos[3];
+ *		baked_eval(&bc, t, pos);	// bc.dim values, t in [0, 1]
+ *	}
+ *
+ * File layout, all values little-endian (the reader assumes a little-endian
+ * host), header and tables 4-byte aligned:
+ *
+ *	 0  magic "CBAK"
+ *	 4  u32 version (1)
+ *	 8  u32 number of curves
+ *	12  curve descriptors, BAKED_DESC_SIZE bytes each:
+ *		 0  u8 format (BAKED_FLOAT32, BAKED_FLOAT16, BAKED_FIXED16)
+ *		 1  u8 dimensions (2 or 3)
+ *		 2  u8 spacing (BAKED_UNIFORM_T, BAKED_ARC_LENGTH)
+ *		 3  u8 reserved (0)
+ *		 4  u32 number of samples
+ *		 8  u32 offset of the table from the start of the file
+ *		12  f32 offset[3]
+ *		24  f32 scale[3]	position = offset + scale * stored value
+ *		36  f32 max error	of baked_eval from the curve
+ *		40  f32 arc length of the curve
+ *
+ * Tables hold samples * dimensions values, sample after sample, as floats,
+ * half floats, or unsigned 16 bit integers.
+ */
+#ifndef BAKEDCURVE_H_
+#define BAKEDCURVE_H_
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(_MSC_VER) && _MSC_VER < 1600
+typedef unsigned short baked_u16;
+typedef unsigned int baked_u32;
+#else
+#include <stdint.h>
+typedef uint16_t baked_u16;
+typedef uint32_t baked_u32;
+#endif
+
+#define BAKED_VERSION		1
+#define BAKED_HEADER_SIZE	12
+#define BAKED_DESC_SIZE		44
+
+enum {
+	BAKED_FLOAT32,
+	BAKED_FLOAT16,
+	BAKED_FIXED16
+};
+
+enum {
+	BAKED_UNIFORM_T,	/* samples uniformly spaced in the curve parameter */
+	BAKED_ARC_LENGTH	/* samples uniformly spaced along the curve */
+};
+
+struct baked_curve {
+	int format, dim, spacing;
+	int samples;
+	float offset[3], scale[3];
+	float max_error;
+	float length;
+	const void *data;
+};
+
+static inline baked_u32 baked_read_u32(const unsigned char *p)
+{
+	baked_u32 x;
+	memcpy(&x, p, 4);
+	return x;
+}
+
+static inline float baked_read_f32(const unsigned char *p)
+{
+	float x;
+	memcpy(&x, p, 4);
+	return x;
+}
+
+/* returns the number of curves in the file, or -1 if it's not a valid baked
+ * curve file.
+ */
+static inline int baked_num_curves(const void *buf, size_t size)
+{
+	const unsigned char *p = (const unsigned char*)buf;
+	baked_u32 count;
+
+	if(size < BAKED_HEADER_SIZE || memcmp(p, "CBAK", 4) != 0 ||
+			baked_read_u32(p + 4) != BAKED_VERSION) {
+		return -1;
+	}
+	count = baked_read_u32(p + 8);
+	if(count > (size - BAKED_HEADER_SIZE) / BAKED_DESC_SIZE) {
+		return -1;
+	}
+	return (int)count;
+}
+
+static inline int baked_value_size(int format)
+{
+	return format == BAKED_FLOAT32 ? 4 : 2;
+}
+
+/* fills bc with the idx-th curve of the file, checking that its table is
+ * within the buffer. Returns 0 on success, -1 on error.
+ */
+static inline int baked_get_curve(const void *buf, size_t size, int idx, struct baked_curve *bc)
+{
+	const unsigned char *p = (const unsigned char*)buf;
+	const unsigned char *desc;
+	baked_u32 offs;
+	size_t tabsize;
+	int i, count = baked_num_curves(buf, size);
+
+	if(idx < 0 || idx >= count) {
+		return -1;
+	}
+	desc = p + BAKED_HEADER_SIZE + idx * BAKED_DESC_SIZE;
+
+	bc->format = desc[0];
+	bc->dim = desc[1];
+	bc->spacing = desc[2];
+	bc->samples = (int)baked_read_u32(desc + 4);
+	offs = baked_read_u32(desc + 8);
+	for(i=0; i<3; i++) {
+		bc->offset[i] = baked_read_f32(desc + 12 + i * 4);
+		bc->scale[i] = baked_read_f32(desc + 24 + i * 4);
+	}
+	bc->max_error = baked_read_f32(desc + 36);
+	bc->length = baked_read_f32(desc + 40);
+
+	if(bc->format > BAKED_FIXED16 || bc->dim < 2 || bc->dim > 3 || bc->samples < 2 ||
+			(offs & 3) != 0 || offs > size) {
+		return -1;
+	}
+	tabsize = (size_t)bc->samples * bc->dim * baked_value_size(bc->format);
+	if(tabsize / bc->dim != (size_t)bc->samples * baked_value_size(bc->format) ||
+			tabsize > size - offs) {
+		return -1;
+	}
+	bc->data = p + offs;
+	return 0;
+}
+
+static inline float baked_half_to_float(baked_u16 h)
+{
+	baked_u32 sign = (baked_u32)(h & 0x8000) << 16;
+	baked_u32 exp = (h >> 10) & 0x1f;
+	baked_u32 mant = h & 0x3ff;
+	baked_u32 bits;
+	float f;
+
+	if(exp == 0) {
+		/* zero or denormal: mant * 2^-24 */
+		f = (float)mant * 5.9604645e-8f;
+		return sign ? -f : f;
+	}
+	if(exp == 31) {
+		bits = sign | 0x7f800000 | (mant << 13);
+	} else {
+		bits = sign | ((exp + 112) << 23) | (mant << 13);
+	}
+	memcpy(&f, &bits, 4);
+	return f;
+}
+
+/* stored values of sample idx, converted to float, before scale and offset */
+static inline void baked_sample(const struct baked_curve *bc, int idx, float *res)
+{
+	int i;
+	const unsigned char *p = (const unsigned char*)bc->data;
+
+	switch(bc->format) {
+	case BAKED_FLOAT32:
+		memcpy(res, p + idx * bc->dim * 4, bc->dim * 4);
+		break;
+
+	case BAKED_FLOAT16:
+		{
+			baked_u16 h[3];
+			memcpy(h, p + idx * bc->dim * 2, bc->dim * 2);
+			for(i=0; i<bc->dim; i++) {
+				res[i] = baked_half_to_float(h[i]);
+			}
+		}
+		break;
+
+	default:
+		{
+			baked_u16 q[3];
+			memcpy(q, p + idx * bc->dim * 2, bc->dim * 2);
+			for(i=0; i<bc->dim; i++) {
+				res[i] = (float)q[i];
+			}
+		}
+	}
+}
+
+/* position at t in [0, 1] (clamped), interpolating linearly between the two
+ * nearest samples. For arc length tables, t is the fraction of the length.
+ * Writes bc->dim values to res.
+ */
+static inline void baked_eval(const struct baked_curve *bc, float t, float *res)
+{
+	int i, idx;
+	float a[3], b[3], x, frac;
+
+	if(!(t > 0.0f)) t = 0.0f;
+	if(t > 1.0f) t = 1.0f;
+
+	x = t * (float)(bc->samples - 1);
+	idx = (int)x;
+	if(idx > bc->samples - 2) {
+		idx = bc->samples - 2;
+	}
+	frac = x - (float)idx;
+
+	baked_sample(bc, idx, a);
+	baked_sample(bc, idx + 1, b);
+	for(i=0; i<bc->dim; i++) {
+		res[i] = bc->offset[i] + bc->scale[i] * (a[i] + (b[i] - a[i]) * frac);
+	}
+}
+
+#endif	/* BAKEDCURVE_H_ */
@@ -0,0 +1,143 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "bezier.h"
+
+#define FLATTEN_MAX_DEPTH	16
+
+static inline Vector3 homog_point(const Vector4 &v)
+{
+	if(v.w == 0.0f) {
+		return Vector3(v.x, v.y, v.z);
+	}
+	float s = 1.0f / v.w;
+	return Vector3(v.x * s, v.y * s, v.z * s);
+}
+
+Vector3 bezier_point(const Bezier &bez, int idx)
+{
+	return homog_point(bez.cp[idx]);
+}
+
+float bezier_weight(const Bezier &bez, int idx)
+{
+	return bez.cp[idx].w;
+}
+
+bool bezier_is_rational(const Bezier &bez)
+{
+	for(int i=0; i<4; i++) {
+		if(bez.cp[i].w != 1.0f) {
+			return true;
+		}
+	}
+	return false;
+}
+
+Vector3 bezier_eval(const Bezier &bez, float t)
+{
+	Vector4 b01 = lerp(bez.cp[0], bez.cp[1], t);
+	Vector4 b12 = lerp(bez.cp[1], bez.cp[2], t);
+	Vector4 b23 = lerp(bez.cp[2], bez.cp[3], t);
+	return homog_point(lerp(lerp(b01, b12, t), lerp(b12, b23, t), t));
+}
+
+void bezier_split(const Bezier &bez, float t, Bezier *left, Bezier *right)
+{
+	Vector4 b01 = lerp(bez.cp[0], bez.cp[1], t);
+	Vector4 b12 = lerp(bez.cp[1], bez.cp[2], t);
+	Vector4 b23 = lerp(bez.cp[2], bez.cp[3], t);
+	Vector4 b012 = lerp(b01, b12, t);
+	Vector4 b123 = lerp(b12, b23, t);
+	Vector4 mid = lerp(b012, b123, t);
+	Vector4 p0 = bez.cp[0];	// bez may be the same as left or right
+	Vector4 p3 = bez.cp[3];
+
+	if(left) {
+		left->cp[0] = p0;
+		left->cp[1] = b01;
+		left->cp[2] = b012;
+		left->cp[3] = mid;
+	}
+	if(right) {
+		right->cp[0] = mid;
+		right->cp[1] = b123;
+		right->cp[2] = b23;
+		right->cp[3] = p3;
+	}
+}
+
+void bezier_hull_bbox(const Bezier &bez, Vector3 *bbmin, Vector3 *bbmax)
+{
+	*bbmin = *bbmax = homog_point(bez.cp[0]);
+	for(int i=1; i<4; i++) {
+		Vector3 p = homog_point(bez.cp[i]);
+		for(int j=0; j<3; j++) {
+			if(p[j] < (*bbmin)[j]) (*bbmin)[j] = p[j];
+			if(p[j] > (*bbmax)[j]) (*bbmax)[j] = p[j];
+		}
+	}
+}
+
+// distance of p from the line segment a-b
+static float chord_dist_sq(const Vector3 &p, const Vector3 &a, const Vector3 &b)
+{
+	Vector3 ab = b - a;
+	float len_sq = ab.length_sq();
+	if(len_sq <= 0.0f) {
+		return (p - a).length_sq();
+	}
+	float t = dot_product(p - a, ab) / len_sq;
+	if(t < 0.0f) t = 0.0f;
+	if(t > 1.0f) t = 1.0f;
+	return (p - (a + ab * t)).length_sq();
+}
+
+/* the curve is contained in the convex hull of the control points (for
+ * positive weights), so the deviation of the curve from the chord is bounded
+ * by the distance of the control points.
+ */
+static void flatten(const Vector4 *bez, const Vector3 &p0, const Vector3 &p3,
+		float tol_sq, int depth, std::vector<Vector3> *out)
+{
+	if(depth >= FLATTEN_MAX_DEPTH || (chord_dist_sq(homog_point(bez[1]), p0, p3) <= tol_sq &&
+				chord_dist_sq(homog_point(bez[2]), p0, p3) <= tol_sq)) {
+		out->push_back(p3);
+		return;
+	}
+
+	Vector4 b01 = (bez[0] + bez[1]) * 0.5f;
+	Vector4 b12 = (bez[1] + bez[2]) * 0.5f;
+	Vector4 b23 = (bez[2] + bez[3]) * 0.5f;
+	Vector4 b012 = (b01 + b12) * 0.5f;
+	Vector4 b123 = (b12 + b23) * 0.5f;
+	Vector4 mid = (b012 + b123) * 0.5f;
+
+	Vector4 left[4] = {bez[0], b01, b012, mid};
+	Vector4 right[4] = {mid, b123, b23, bez[3]};
+	Vector3 pmid = homog_point(mid);
+
+	flatten(left, p0, pmid, tol_sq, depth + 1, out);
+	flatten(right, pmid, p3, tol_sq, depth + 1, out);
+}
+
+int bezier_flatten(const Bezier &bez, float tol, std::vector<Vector3> *out)
+{
+	size_t start = out->size();
+	flatten(bez.cp, homog_point(bez.cp[0]), homog_point(bez.cp[3]), tol * tol, 0, out);
+	return (int)(out->size() - start);
+}
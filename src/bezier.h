@@ -0,0 +1,56 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BEZIER_H_
+#define BEZIER_H_
+
+#include <vector>
+#include <vmath/vmath.h>
+
+/* cubic rational bezier segment, with the control points in homogeneous form
+ * (x w, y w, z w, w). Non-rational segments have w = 1 everywhere, and the
+ * control points are the positions themselves.
+ * See Curve::get_bezier for the exact bezier form of curve segments.
+ */
+struct Bezier {
+	Vector4 cp[4];
+};
+
+// position and weight of control point idx
+Vector3 bezier_point(const Bezier &bez, int idx);
+float bezier_weight(const Bezier &bez, int idx);
+// false if all weights are 1
+bool bezier_is_rational(const Bezier &bez);
+
+// evaluate at t in [0, 1] (de Casteljau)
+Vector3 bezier_eval(const Bezier &bez, float t);
+/* split at t into the segments [0, t] and [t, 1] (de Casteljau). Either of
+ * left or right may be null.
+ */
+void bezier_split(const Bezier &bez, float t, Bezier *left, Bezier *right);
+/* bounds of the control points, which contain the segment if the weights
+ * are positive.
+ */
+void bezier_hull_bbox(const Bezier &bez, Vector3 *bbmin, Vector3 *bbmax);
+
+/* flatten the segment into a polyline, splitting it in half until the inner
+ * control points are within tol of the chord. Appends all vertices except the
+ * start point, and returns how many.
+ */
+int bezier_flatten(const Bezier &bez, float tol, std::vector<Vector3> *out);
+
+#endif	// BEZIER_H_
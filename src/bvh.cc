@@ -0,0 +1,437 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <float.h>
+#include <algorithm>
+#include <utility>
+#include "bvh.h"
+
+// unbounded curves get huge (but finite) bounds, to keep the area math sane
+#define BVH_INF		1e18f
+// leaf bounds are enlarged by this fraction of their size
+#define BVH_MARGIN	0.05f
+
+static inline void box_union(Vector3 *bmin, Vector3 *bmax, const Vector3 &amin, const Vector3 &amax,
+		const Vector3 &bbmin, const Vector3 &bbmax)
+{
+	for(int i=0; i<3; i++) {
+		(*bmin)[i] = std::min(amin[i], bbmin[i]);
+		(*bmax)[i] = std::max(amax[i], bbmax[i]);
+	}
+}
+
+static inline double box_area(const Vector3 &bmin, const Vector3 &bmax)
+{
+	double dx = bmax.x - bmin.x;
+	double dy = bmax.y - bmin.y;
+	double dz = bmax.z - bmin.z;
+	return 2.0 * (dx * dy + dy * dz + dz * dx);
+}
+
+static inline double union_area(const Vector3 &amin, const Vector3 &amax,
+		const Vector3 &bmin, const Vector3 &bmax)
+{
+	Vector3 umin, umax;
+	box_union(&umin, &umax, amin, amax, bmin, bmax);
+	return box_area(umin, umax);
+}
+
+static inline bool box_contains(const Vector3 &outmin, const Vector3 &outmax,
+		const Vector3 &bmin, const Vector3 &bmax)
+{
+	for(int i=0; i<3; i++) {
+		if(bmin[i] < outmin[i] || bmax[i] > outmax[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static inline bool box_overlap(const Vector3 &amin, const Vector3 &amax,
+		const Vector3 &bmin, const Vector3 &bmax)
+{
+	for(int i=0; i<3; i++) {
+		if(amin[i] > bmax[i] || amax[i] < bmin[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static inline float box_dist_sq(const Vector3 &p, const Vector3 &bmin, const Vector3 &bmax)
+{
+	float dsq = 0.0f;
+	for(int i=0; i<3; i++) {
+		float d = 0.0f;
+		if(p[i] < bmin[i]) {
+			d = bmin[i] - p[i];
+		} else if(p[i] > bmax[i]) {
+			d = p[i] - bmax[i];
+		}
+		dsq += d * d;
+	}
+	return dsq;
+}
+
+// union of the control point bounds and the curve bounds
+static void curve_bounds(const Curve *curve, Vector3 *bmin, Vector3 *bmax)
+{
+	Vector3 cpmin, cpmax, cmin, cmax;
+	curve->get_bbox(&cpmin, &cpmax);
+	curve->get_curve_bbox(&cmin, &cmax);
+	box_union(bmin, bmax, cpmin, cpmax, cmin, cmax);
+
+	for(int i=0; i<3; i++) {
+		(*bmin)[i] = std::max((*bmin)[i], -BVH_INF);
+		(*bmax)[i] = std::min((*bmax)[i], BVH_INF);
+	}
+}
+
+
+CurveBVH::CurveBVH()
+{
+	root = -1;
+	freelist = -1;
+}
+
+int CurveBVH::alloc_node()
+{
+	int idx;
+	if(freelist != -1) {
+		idx = freelist;
+		freelist = nodes[idx].parent;
+	} else {
+		idx = (int)nodes.size();
+		nodes.push_back(Node());
+	}
+
+	Node *n = &nodes[idx];
+	n->parent = -1;
+	n->child[0] = n->child[1] = -1;
+	n->curve = 0;
+	n->version = 0;
+	return idx;
+}
+
+void CurveBVH::free_node(int idx)
+{
+	nodes[idx].curve = 0;
+	nodes[idx].parent = freelist;	// the parent link doubles as the free list link
+	freelist = idx;
+}
+
+void CurveBVH::clear()
+{
+	nodes.clear();
+	leaves.clear();
+	root = -1;
+	freelist = -1;
+}
+
+void CurveBVH::calc_leaf_bounds(int leaf)
+{
+	Node *n = &nodes[leaf];
+	curve_bounds(n->curve, &n->bmin, &n->bmax);
+
+	Vector3 margin = (n->bmax - n->bmin) * BVH_MARGIN;
+	n->bmin -= margin;
+	n->bmax += margin;
+	n->version = n->curve->get_version();
+}
+
+void CurveBVH::build(Curve * const *curves, int count)
+{
+	clear();
+	if(count <= 0) return;
+
+	std::vector<int> leafidx(count);
+	for(int i=0; i<count; i++) {
+		int leaf = alloc_node();
+		nodes[leaf].curve = curves[i];
+		calc_leaf_bounds(leaf);
+		leaves[curves[i]] = leaf;
+		leafidx[i] = leaf;
+	}
+
+	root = build_rec(&leafidx[0], count);
+	nodes[root].parent = -1;
+}
+
+int CurveBVH::build_rec(int *leafidx, int count)
+{
+	if(count == 1) {
+		return leafidx[0];
+	}
+
+	// split along the longest axis of the centroid bounds, at the median
+	Vector3 cmin = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vector3 cmax = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for(int i=0; i<count; i++) {
+		const Node &n = nodes[leafidx[i]];
+		for(int j=0; j<3; j++) {
+			float c = (n.bmin[j] + n.bmax[j]) * 0.5f;
+			cmin[j] = std::min(cmin[j], c);
+			cmax[j] = std::max(cmax[j], c);
+		}
+	}
+	Vector3 csize = cmax - cmin;
+	int axis = 0;
+	if(csize.y > csize[axis]) axis = 1;
+	if(csize.z > csize[axis]) axis = 2;
+
+	std::vector<std::pair<float, int> > keys(count);
+	for(int i=0; i<count; i++) {
+		const Node &n = nodes[leafidx[i]];
+		keys[i] = std::make_pair(n.bmin[axis] + n.bmax[axis], leafidx[i]);
+	}
+	int mid = count / 2;
+	std::nth_element(keys.begin(), keys.begin() + mid, keys.end());
+	for(int i=0; i<count; i++) {
+		leafidx[i] = keys[i].second;
+	}
+
+	int left = build_rec(leafidx, mid);
+	int right = build_rec(leafidx + mid, count - mid);
+
+	int idx = alloc_node();		// may reallocate nodes, don't hold references across
+	Node *n = &nodes[idx];
+	n->child[0] = left;
+	n->child[1] = right;
+	box_union(&n->bmin, &n->bmax, nodes[left].bmin, nodes[left].bmax,
+			nodes[right].bmin, nodes[right].bmax);
+	nodes[left].parent = nodes[right].parent = idx;
+	return idx;
+}
+
+bool CurveBVH::add(Curve *curve)
+{
+	if(leaves.find(curve) != leaves.end()) {
+		return false;
+	}
+
+	int leaf = alloc_node();
+	nodes[leaf].curve = curve;
+	calc_leaf_bounds(leaf);
+	leaves[curve] = leaf;
+
+	insert_leaf(leaf);
+	return true;
+}
+
+bool CurveBVH::remove(const Curve *curve)
+{
+	std::map<const Curve*, int>::iterator it = leaves.find(curve);
+	if(it == leaves.end()) {
+		return false;
+	}
+
+	int leaf = it->second;
+	leaves.erase(it);
+	remove_leaf(leaf);
+	free_node(leaf);
+	return true;
+}
+
+bool CurveBVH::update(const Curve *curve)
+{
+	std::map<const Curve*, int>::iterator it = leaves.find(curve);
+	if(it == leaves.end()) {
+		return false;
+	}
+
+	int leaf = it->second;
+	Node *n = &nodes[leaf];
+	if(n->version == curve->get_version()) {
+		return true;
+	}
+
+	Vector3 bmin, bmax;
+	curve_bounds(curve, &bmin, &bmax);
+	if(box_contains(n->bmin, n->bmax, bmin, bmax)) {
+		// still within the enlarged bounds, nothing to do
+		n->version = curve->get_version();
+		return true;
+	}
+
+	remove_leaf(leaf);
+	calc_leaf_bounds(leaf);
+	insert_leaf(leaf);
+	return true;
+}
+
+bool CurveBVH::contains(const Curve *curve) const
+{
+	return leaves.find(curve) != leaves.end();
+}
+
+int CurveBVH::size() const
+{
+	return (int)leaves.size();
+}
+
+/* insert a leaf next to the sibling which results in the least increase of
+ * total surface area (branch and bound descent, as in Box2D's dynamic tree).
+ */
+void CurveBVH::insert_leaf(int leaf)
+{
+	if(root == -1) {
+		root = leaf;
+		nodes[leaf].parent = -1;
+		return;
+	}
+
+	Vector3 lmin = nodes[leaf].bmin;
+	Vector3 lmax = nodes[leaf].bmax;
+
+	int idx = root;
+	while(nodes[idx].child[0] != -1) {
+		const Node &n = nodes[idx];
+		double area = box_area(n.bmin, n.bmax);
+		double combined = union_area(n.bmin, n.bmax, lmin, lmax);
+
+		// cost of creating a new parent for this node and the leaf
+		double cost = 2.0 * combined;
+		// minimum cost of pushing the leaf further down
+		double inherit = 2.0 * (combined - area);
+
+		double child_cost[2];
+		for(int i=0; i<2; i++) {
+			const Node &c = nodes[n.child[i]];
+			double carea = union_area(c.bmin, c.bmax, lmin, lmax);
+			if(c.child[0] != -1) {
+				carea -= box_area(c.bmin, c.bmax);
+			}
+			child_cost[i] = carea + inherit;
+		}
+
+		if(cost < child_cost[0] && cost < child_cost[1]) {
+			break;
+		}
+		idx = child_cost[0] < child_cost[1] ? n.child[0] : n.child[1];
+	}
+
+	int sibling = idx;
+	int old_parent = nodes[sibling].parent;
+	int parent = alloc_node();
+
+	Node *p = &nodes[parent];
+	p->parent = old_parent;
+	p->child[0] = sibling;
+	p->child[1] = leaf;
+	box_union(&p->bmin, &p->bmax, nodes[sibling].bmin, nodes[sibling].bmax, lmin, lmax);
+
+	if(old_parent == -1) {
+		root = parent;
+	} else {
+		Node *op = &nodes[old_parent];
+		op->child[op->child[0] == sibling ? 0 : 1] = parent;
+	}
+	nodes[sibling].parent = parent;
+	nodes[leaf].parent = parent;
+
+	refit(old_parent);
+}
+
+void CurveBVH::remove_leaf(int leaf)
+{
+	if(leaf == root) {
+		root = -1;
+		return;
+	}
+
+	int parent = nodes[leaf].parent;
+	int grandparent = nodes[parent].parent;
+	int sibling = nodes[parent].child[0] == leaf ? nodes[parent].child[1] : nodes[parent].child[0];
+
+	if(grandparent == -1) {
+		root = sibling;
+		nodes[sibling].parent = -1;
+	} else {
+		Node *gp = &nodes[grandparent];
+		gp->child[gp->child[0] == parent ? 0 : 1] = sibling;
+		nodes[sibling].parent = grandparent;
+	}
+	free_node(parent);
+	nodes[leaf].parent = -1;
+
+	refit(grandparent);
+}
+
+// recalculate the bounds of idx and all its ancestors
+void CurveBVH::refit(int idx)
+{
+	while(idx != -1) {
+		Node *n = &nodes[idx];
+		const Node &a = nodes[n->child[0]];
+		const Node &b = nodes[n->child[1]];
+		box_union(&n->bmin, &n->bmax, a.bmin, a.bmax, b.bmin, b.bmax);
+		idx = n->parent;
+	}
+}
+
+int CurveBVH::query(const Vector3 &p, float radius, std::vector<Curve*> *res) const
+{
+	if(root == -1) return 0;
+
+	int count = 0;
+	float rsq = radius * radius;
+
+	std::vector<int> stack;
+	stack.push_back(root);
+	while(!stack.empty()) {
+		const Node &n = nodes[stack.back()];
+		stack.pop_back();
+
+		if(box_dist_sq(p, n.bmin, n.bmax) > rsq) {
+			continue;
+		}
+		if(n.child[0] == -1) {
+			res->push_back(n.curve);
+			++count;
+		} else {
+			stack.push_back(n.child[0]);
+			stack.push_back(n.child[1]);
+		}
+	}
+	return count;
+}
+
+int CurveBVH::query(const Vector3 &bmin, const Vector3 &bmax, std::vector<Curve*> *res) const
+{
+	if(root == -1) return 0;
+
+	int count = 0;
+
+	std::vector<int> stack;
+	stack.push_back(root);
+	while(!stack.empty()) {
+		const Node &n = nodes[stack.back()];
+		stack.pop_back();
+
+		if(!box_overlap(n.bmin, n.bmax, bmin, bmax)) {
+			continue;
+		}
+		if(n.child[0] == -1) {
+			res->push_back(n.curve);
+			++count;
+		} else {
+			stack.push_back(n.child[0]);
+			stack.push_back(n.child[1]);
+		}
+	}
+	return count;
+}
@@ -0,0 +1,77 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BVH_H_
+#define BVH_H_
+
+#include <vector>
+#include <map>
+#include "curve.h"
+
+/* bounding volume hierarchy over the bounds of a set of curves, for finding
+ * the few curves near a point without testing every curve in the scene.
+ * Leaves hold the union of the control point and curve bounds, enlarged by a
+ * margin, so that small edits only need to check the leaf; larger edits
+ * re-insert the curve. build creates a balanced tree for a whole set of
+ * curves, add/remove/update modify the tree incrementally.
+ */
+class CurveBVH {
+private:
+	struct Node {
+		Vector3 bmin, bmax;
+		int parent;
+		int child[2];		// -1 for leaves
+		Curve *curve;		// leaves only
+		unsigned int version;	// curve version when the leaf bounds were calculated
+	};
+	std::vector<Node> nodes;
+	int root;
+	int freelist;
+	std::map<const Curve*, int> leaves;
+
+	int alloc_node();
+	void free_node(int idx);
+	int build_rec(int *leafidx, int count);
+	void insert_leaf(int leaf);
+	void remove_leaf(int leaf);
+	void refit(int idx);
+	void calc_leaf_bounds(int leaf);
+
+public:
+	CurveBVH();
+
+	void clear();
+	// replace the contents of the tree with a balanced tree of these curves
+	void build(Curve * const *curves, int count);
+
+	bool add(Curve *curve);
+	bool remove(const Curve *curve);
+	// call after modifying a curve, does nothing if the curve is unchanged
+	bool update(const Curve *curve);
+
+	bool contains(const Curve *curve) const;
+	int size() const;
+
+	/* query appends the curves whose bounds are within radius of p, or
+	 * which intersect the box bmin-bmax, and returns how many were found.
+	 * Both are conservative: the curves themselves may be farther.
+	 */
+	int query(const Vector3 &p, float radius, std::vector<Curve*> *res) const;
+	int query(const Vector3 &bmin, const Vector3 &bmax, std::vector<Curve*> *res) const;
+};
+
+#endif	// BVH_H_
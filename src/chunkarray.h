@@ -0,0 +1,409 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CHUNKARRAY_H_
+#define CHUNKARRAY_H_
+
+#include <assert.h>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+/* ChunkArray is a sequence stored in contiguous chunks of up to CHUNK
+ * elements, for large arrays with insertions and removals in the middle.
+ * A Fenwick tree of the chunk sizes maps element indices to chunks.
+ *
+ * - element access by index: O(log(n / CHUNK))
+ * - insert/erase: O(CHUNK + log(n / CHUNK)), plus O(n / CHUNK) when a chunk
+ *   is split, merged or removed, which happens at most once every CHUNK / 4
+ *   operations
+ * - push_back: amortized O(1)
+ *
+ * Sequential traversal should use the iterators, or walk the chunks directly
+ * (num_chunks, chunk, chunk_size), which touches memory in order.
+ * References to elements are invalidated by insert and erase, and by non-const
+ * access after the array was copied.
+ *
+ * Each chunk allocates room for its elements as they are added, doubling up
+ * to CHUNK, so short arrays stay small.
+ *
+ * Copies share their chunks, and a chunk is only duplicated when one of the
+ * copies modifies it (copy-on-write), so copying takes O(n / CHUNK). A copy
+ * can be read by one thread while another modifies the original, but not
+ * while it is being made.
+ */
+template <typename T, int CHUNK = 512>
+class ChunkArray {
+private:
+	enum { MIN_CAPACITY = 4 };
+
+	// elements of a chunk, shared by the copies of the array
+	struct Block {
+		std::vector<T> elem;	// capacity grows geometrically up to CHUNK
+		std::atomic<int> refs;
+	};
+
+	// reference counted handle of a block, and the number of elements used
+	class Chunk {
+	private:
+		Block *blk;
+
+		void release()
+		{
+			if(blk->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				delete blk;
+			}
+		}
+
+	public:
+		T *data;	// blk->elem.data(), kept here to save an indirection
+		int size;	// may be less than blk->elem.size() after a split
+
+		explicit Chunk(int capacity) : blk(new Block)
+		{
+			blk->refs = 1;
+			blk->elem.reserve(capacity);
+			data = blk->elem.data();
+			size = 0;
+		}
+		Chunk(const Chunk &c) : blk(c.blk), data(c.data), size(c.size)
+		{
+			blk->refs.fetch_add(1, std::memory_order_relaxed);
+		}
+		~Chunk() { release(); }
+
+		Chunk &operator =(const Chunk &c)
+		{
+			c.blk->refs.fetch_add(1, std::memory_order_relaxed);
+			release();
+			blk = c.blk;
+			data = c.data;
+			size = c.size;
+			return *this;
+		}
+
+		std::vector<T> &elem() { return blk->elem; }
+		int capacity() const { return (int)blk->elem.capacity(); }
+
+		// update data and size after changing elem
+		void sync()
+		{
+			data = blk->elem.data();
+			size = (int)blk->elem.size();
+		}
+
+		// acquire, to see the reads of the other copies done before they let go
+		bool shared() const { return blk->refs.load(std::memory_order_acquire) > 1; }
+	};
+
+	std::vector<Chunk> chunks;
+	std::vector<int> tree;	// fenwick tree of the chunk sizes (1-based)
+	int count;
+	int top_step;			// largest power of two <= number of chunks
+
+	// make room for n elements, growing the capacity geometrically up to CHUNK
+	static void reserve(std::vector<T> &elem, int n)
+	{
+		int cap = (int)elem.capacity();
+		if(cap < n) {
+			cap = std::max(std::max(cap * 2, n), (int)MIN_CAPACITY);
+			elem.reserve(std::min(cap, CHUNK));
+		}
+	}
+
+	/* elements of chunk c, duplicated first if shared with another copy.
+	 * Call sync on the chunk after changing their number.
+	 */
+	std::vector<T> &modify(int c)
+	{
+		Chunk &ch = chunks[c];
+		if(ch.shared()) {
+			Chunk dup(ch.size);
+			dup.elem().assign(ch.data, ch.data + ch.size);
+			dup.sync();
+			ch = dup;
+		}
+		std::vector<T> &elem = ch.elem();
+		elem.resize(ch.size);	// drop the elements moved out by a split
+		return elem;
+	}
+
+	void rebuild()
+	{
+		int nchunks = (int)chunks.size();
+		tree.assign(nchunks + 1, 0);
+		for(int i=1; i<=nchunks; i++) {
+			tree[i] += chunks[i - 1].size;
+			int parent = i + (i & -i);
+			if(parent <= nchunks) {
+				tree[parent] += tree[i];
+			}
+		}
+
+		top_step = 1;
+		while(top_step * 2 <= nchunks) {
+			top_step *= 2;
+		}
+	}
+
+	void add_size(int c, int delta)
+	{
+		for(int i=c+1; i<(int)tree.size(); i+=i & -i) {
+			tree[i] += delta;
+		}
+	}
+
+	// chunk containing element idx (0 <= idx < count), and its offset in it
+	int find(int idx, int *offs) const
+	{
+		int pos = 0;
+		int nchunks = (int)chunks.size();
+		for(int step=top_step; step>0; step>>=1) {
+			if(pos + step <= nchunks && tree[pos + step] <= idx) {
+				pos += step;
+				idx -= tree[pos];
+			}
+		}
+		*offs = idx;
+		return pos;
+	}
+
+	// insert v at offs of chunk c, which must not be full
+	void insert_in_chunk(int c, int offs, const T &v)
+	{
+		std::vector<T> &elem = modify(c);
+		reserve(elem, elem.size() + 1);
+		elem.insert(elem.begin() + offs, v);
+		chunks[c].sync();
+	}
+
+public:
+	class const_iterator {
+	private:
+		const ChunkArray *arr;
+		int c, offs;
+
+	public:
+		const_iterator() : arr(0), c(0), offs(0) {}
+		const_iterator(const ChunkArray *arr, int c, int offs) : arr(arr), c(c), offs(offs) {}
+
+		const T &operator *() const { return arr->chunks[c].data[offs]; }
+		const T *operator ->() const { return arr->chunks[c].data + offs; }
+
+		const_iterator &operator ++()
+		{
+			if(++offs >= arr->chunks[c].size) {
+				++c;
+				offs = 0;
+			}
+			return *this;
+		}
+
+		bool operator ==(const const_iterator &it) const { return c == it.c && offs == it.offs; }
+		bool operator !=(const const_iterator &it) const { return c != it.c || offs != it.offs; }
+	};
+
+	ChunkArray()
+	{
+		count = 0;
+		top_step = 1;
+		tree.resize(1, 0);
+	}
+
+	int size() const
+	{
+		return count;
+	}
+
+	bool empty() const
+	{
+		return count == 0;
+	}
+
+	void clear()
+	{
+		chunks.clear();
+		count = 0;
+		rebuild();
+	}
+
+	T &operator [](int idx)
+	{
+		int offs;
+		int c = find(idx, &offs);
+		return modify(c)[offs];
+	}
+
+	const T &operator [](int idx) const
+	{
+		int offs;
+		int c = find(idx, &offs);
+		return chunks[c].data[offs];
+	}
+
+	void push_back(const T &v)
+	{
+		if(chunks.empty() || chunks.back().size >= CHUNK) {
+			chunks.push_back(Chunk(MIN_CAPACITY));
+			chunks.back().elem().push_back(v);
+			chunks.back().sync();
+			++count;
+
+			/* append the tree node of the new chunk, which covers the chunks
+			 * (n - lowbit(n), n], without rebuilding the whole tree
+			 */
+			int n = (int)chunks.size();
+			int sum = 1;
+			for(int i=n-1; i>n-(n & -n); i-=i & -i) {
+				sum += tree[i];
+			}
+			tree.push_back(sum);
+			if(top_step * 2 <= n) {
+				top_step *= 2;
+			}
+			return;
+		}
+		int last = (int)chunks.size() - 1;
+		std::vector<T> &elem = modify(last);
+		reserve(elem, elem.size() + 1);
+		elem.push_back(v);
+		chunks[last].sync();
+		add_size(last, 1);
+		++count;
+	}
+
+	// insert v before element idx (0 <= idx <= size)
+	void insert(int idx, const T &v)
+	{
+		assert(idx >= 0 && idx <= count);
+		if(idx == count) {
+			push_back(v);
+			return;
+		}
+
+		int offs;
+		int c = find(idx, &offs);
+		if(chunks[c].size >= CHUNK) {
+			// split the full chunk in half (the first half stays in place)
+			Chunk half(CHUNK - CHUNK / 2);
+			const T *src = chunks[c].data;
+			half.elem().assign(src + CHUNK / 2, src + CHUNK);
+			half.sync();
+			chunks[c].size = CHUNK / 2;
+			chunks.insert(chunks.begin() + c + 1, half);
+
+			if(offs >= CHUNK / 2) {
+				offs -= CHUNK / 2;
+				++c;
+			}
+			insert_in_chunk(c, offs, v);
+			++count;
+			rebuild();
+			return;
+		}
+
+		insert_in_chunk(c, offs, v);
+		add_size(c, 1);
+		++count;
+	}
+
+	void erase(int idx)
+	{
+		assert(idx >= 0 && idx < count);
+
+		int offs;
+		int c = find(idx, &offs);
+		std::vector<T> &elem = modify(c);
+		elem.erase(elem.begin() + offs);
+		chunks[c].sync();
+		int sz = chunks[c].size;
+		--count;
+
+		if(sz == 0) {
+			chunks.erase(chunks.begin() + c);
+			rebuild();
+			return;
+		}
+
+		// merge mostly empty chunks with a neighbour
+		if(sz < CHUNK / 4) {
+			int other = -1;
+			if(c + 1 < (int)chunks.size() && sz + chunks[c + 1].size <= CHUNK) {
+				other = c + 1;
+			} else if(c > 0 && sz + chunks[c - 1].size <= CHUNK) {
+				other = c - 1;
+			}
+			if(other != -1) {
+				int first = other < c ? other : c;
+				const Chunk &next = chunks[first + 1];
+				std::vector<T> &elem = modify(first);
+				reserve(elem, elem.size() + next.size);
+				elem.insert(elem.end(), next.data, next.data + next.size);
+				chunks[first].sync();
+				chunks.erase(chunks.begin() + first + 1);
+				rebuild();
+				return;
+			}
+		}
+		add_size(c, -1);
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator(this, 0, 0);
+	}
+
+	const_iterator end() const
+	{
+		return const_iterator(this, (int)chunks.size(), 0);
+	}
+
+	int num_chunks() const
+	{
+		return (int)chunks.size();
+	}
+
+	int chunk_size(int c) const
+	{
+		return chunks[c].size;
+	}
+
+	T *chunk(int c)
+	{
+		return modify(c).data();
+	}
+
+	const T *chunk(int c) const
+	{
+		return chunks[c].data;
+	}
+
+	/* bytes allocated by the array, counting the chunks shared with other
+	 * copies as well
+	 */
+	size_t mem_usage() const
+	{
+		size_t sz = sizeof *this + chunks.capacity() * sizeof(Chunk) +
+			tree.capacity() * sizeof(int);
+		for(size_t i=0; i<chunks.size(); i++) {
+			sz += sizeof(Block) + chunks[i].capacity() * sizeof(T);
+		}
+		return sz;
+	}
+};
+
+#endif	// CHUNKARRAY_H_
@@ -23,39 +23,46 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 Curve::Curve(CurveType type)
 {
 	this->type = type;
+	version = 0;
 	bbvalid = true;
+	coefvalid = false;
+	coefrational = false;
+	segbbvalid = false;
+	arclenvalid = false;
+	tessvalid = false;
+	tess_tol = 0.0f;
 }
 
 Curve::Curve(const Vector4 *cp, int numcp, CurveType type)
 	: Curve(type)
 {
-	this->cp.resize(numcp);
 	for(int i=0; i<numcp; i++) {
-		this->cp[i] = cp[i];
+		this->cp.push_back(cp[i]);
 	}
 }
 
 Curve::Curve(const Vector3 *cp, int numcp, CurveType type)
 	: Curve(type)
 {
-	this->cp.resize(numcp);
 	for(int i=0; i<numcp; i++) {
-		this->cp[i] = Vector4(cp[i].x, cp[i].y, cp[i].z, 1.0f);
+		this->cp.push_back(Vector4(cp[i].x, cp[i].y, cp[i].z, 1.0f));
 	}
 }
 
 Curve::Curve(const Vector2 *cp, int numcp, CurveType type)
 	: Curve(type)
 {
-	this->cp.resize(numcp);
 	for(int i=0; i<numcp; i++) {
-		this->cp[i] = Vector4(cp[i].x, cp[i].y, 0.0f, 1.0f);
+		this->cp.push_back(Vector4(cp[i].x, cp[i].y, 0.0f, 1.0f));
 	}
 }
 
 void Curve::set_type(CurveType type)
 {
-	this->type = type;
+	if(type != this->type) {
+		this->type = type;
+		invalidate();
+	}
 }
 
 CurveType Curve::get_type() const
@@ -63,10 +70,15 @@ CurveType Curve::get_type() const
 	return type;
 }
 
+unsigned int Curve::get_version() const
+{
+	return version;
+}
+
 void Curve::add_point(const Vector4 &p)
 {
 	cp.push_back(p);
-	inval_bounds();
+	invalidate();
 }
 
 void Curve::add_point(const Vector3 &p, float weight)
@@ -86,9 +98,9 @@ void Curve::insert_point(const Vector4 &p)
 		add_point(p);
 	} else {
 		int after = (int)(t * (size() - 1));
-		cp.insert(cp.begin() + after + 1, p);
+		cp.insert(after + 1, p);
 	}
-	inval_bounds();
+	invalidate();
 }
 
 void Curve::insert_point(const Vector3 &p, float weight)
@@ -106,15 +118,15 @@ bool Curve::remove_point(int idx)
 	if(idx < 0 || idx >= (int)cp.size()) {
 		return false;
 	}
-	cp.erase(cp.begin() + idx);
-	inval_bounds();
+	cp.erase(idx);
+	invalidate();
 	return true;
 }
 
 void Curve::clear()
 {
 	cp.clear();
-	inval_bounds();
+	invalidate();
 }
 
 bool Curve::empty() const
@@ -127,12 +139,6 @@ int Curve::size() const
 	return (int)cp.size();
 }
 
-Vector4 &Curve::operator [](int idx)
-{
-	inval_bounds();
-	return cp[idx];
-}
-
 const Vector4 &Curve::operator [](int idx) const
 {
 	return cp[idx];
@@ -164,7 +170,7 @@ bool Curve::set_point(int idx, const Vector3 &p, float weight)
 		return false;
 	}
 	cp[idx] = Vector4(p.x, p.y, p.z, weight);
-	inval_bounds();
+	invalidate();
 	return true;
 }
 
@@ -174,7 +180,7 @@ bool Curve::set_point(int idx, const Vector2 &p, float weight)
 		return false;
 	}
 	cp[idx] = Vector4(p.x, p.y, 0.0, weight);
-	inval_bounds();
+	invalidate();
 	return true;
 }
 
@@ -184,6 +190,7 @@ bool Curve::set_weight(int idx, float weight)
 		return false;
 	}
 	cp[idx].w = weight;
+	invalidate();
 	return true;
 }
 
@@ -193,7 +200,7 @@ bool Curve::move_point(int idx, const Vector3 &p)
 		return false;
 	}
 	cp[idx] = Vector4(p.x, p.y, p.z, cp[idx].w);
-	inval_bounds();
+	invalidate();
 	return true;
 }
 
@@ -203,7 +210,7 @@ bool Curve::move_point(int idx, const Vector2 &p)
 		return false;
 	}
 	cp[idx] = Vector4(p.x, p.y, 0.0f, cp[idx].w);
-	inval_bounds();
+	invalidate();
 	return true;
 }
 
@@ -213,8 +220,9 @@ int Curve::nearest_point(const Vector3 &p) const
 	int res = -1;
 	float bestsq = FLT_MAX;
 
-	for(size_t i=0; i<cp.size(); i++) {
-		float d = (get_point3(i) - p).length_sq();
+	ChunkArray<Vector4>::const_iterator it = cp.begin();
+	for(int i=0; it!=cp.end(); ++it, ++i) {
+		float d = (Vector3(it->x, it->y, it->z) - p).length_sq();
 		if(d < bestsq) {
 			bestsq = d;
 			res = i;
@@ -228,8 +236,9 @@ int Curve::nearest_point(const Vector2 &p) const
 	int res = -1;
 	float bestsq = FLT_MAX;
 
-	for(size_t i=0; i<cp.size(); i++) {
-		float d = (get_point2(i) - p).length_sq();
+	ChunkArray<Vector4>::const_iterator it = cp.begin();
+	for(int i=0; it!=cp.end(); ++it, ++i) {
+		float d = (Vector2(it->x, it->y) - p).length_sq();
 		if(d < bestsq) {
 			bestsq = d;
 			res = i;
@@ -244,6 +253,16 @@ void Curve::inval_bounds() const
 	bbvalid = false;
 }
 
+void Curve::invalidate()
+{
+	++version;
+	inval_bounds();
+	coefvalid = false;
+	segbbvalid = false;
+	arclenvalid = false;
+	tessvalid = false;
+}
+
 void Curve::calc_bounds() const
 {
 	calc_bbox(&bbmin, &bbmax);
@@ -268,8 +287,9 @@ void Curve::calc_bbox(Vector3 *bbmin, Vector3 *bbmax) const
 
 	Vector3 bmin = cp[0];
 	Vector3 bmax = bmin;
-	for(size_t i=1; i<cp.size(); i++) {
-		const Vector4 &v = cp[i];
+	ChunkArray<Vector4>::const_iterator it = cp.begin();
+	for(; it!=cp.end(); ++it) {
+		const Vector4 &v = *it;
 		for(int j=0; j<3; j++) {
 			if(v[j] < bmin[j]) bmin[j] = v[j];
 			if(v[j] > bmax[j]) bmax[j] = v[j];
@@ -293,68 +313,21 @@ void Curve::normalize()
 	bscale.y = bsize.y == 0.0f ? 1.0f : 1.0f / bsize.y;
 	bscale.z = bsize.z == 0.0f ? 1.0f : 1.0f / bsize.z;
 
-	for(size_t i=0; i<cp.size(); i++) {
-		cp[i].x = (cp[i].x - boffs.x) * bscale.x;
-		cp[i].y = (cp[i].y - boffs.y) * bscale.y;
-		cp[i].z = (cp[i].z - boffs.z) * bscale.z;
-	}
-	inval_bounds();
-}
-
-float Curve::proj_param(const Vector3 &p, float refine_thres) const
-{
-	// first step through the curve a few times and find the nearest of them
-	int num_cp = size();
-	int num_steps = num_cp * 5;	// arbitrary number; sounds ok
-	float dt = 1.0f / (float)(num_steps - 1);
-
-	float best_distsq = FLT_MAX;
-	float best_t = 0.0f;
-	Vector3 best_pp;
-
-	float t = 0.0f;
-	for(int i=0; i<num_steps; i++) {
-		Vector3 pp = interpolate(t);
-		float distsq = (pp - p).length_sq();
-		if(distsq < best_distsq) {
-			best_distsq = distsq;
-			best_pp = pp;
-			best_t = t;
-		}
-		t += dt;
-	}
-
-	// refine by gradient descent
-	float dist = best_distsq;
-	t = best_t;
-	dt *= 0.05;
-	for(;;) {
-		float tn = t + dt;
-		float tp = t - dt;
-
-		float dn = (interpolate(tn) - p).length_sq();
-		float dp = (interpolate(tp) - p).length_sq();
-
-		if(fabs(dn - dp) < refine_thres * refine_thres) {
-			break;
-		}
-
-		if(dn < dist) {
-			t = tn;
-			dist = dn;
-		} else if(dp < dist) {
-			t = tp;
-			dist = dp;
-		} else {
-			break;	// found the minimum
+	for(int i=0; i<cp.num_chunks(); i++) {
+		Vector4 *v = cp.chunk(i);
+		int num = cp.chunk_size(i);
+		for(int j=0; j<num; j++) {
+			v[j].x = (v[j].x - boffs.x) * bscale.x;
+			v[j].y = (v[j].y - boffs.y) * bscale.y;
+			v[j].z = (v[j].z - boffs.z) * bscale.z;
 		}
 	}
-	return t;
+	invalidate();
 }
 
-Vector3 Curve::proj_point(const Vector3 &p, float refine_thres) const
+Vector3 Curve::proj_point(const Vector3 &p) const
 {
-	float t = proj_param(p, refine_thres);
+	float t = proj_param(p);
 	return interpolate(t);
 }
 
@@ -369,24 +342,17 @@ float Curve::distance_sq(const Vector3 &p) const
 }
 
 
-Vector3 Curve::interpolate_segment(int a, int b, float t) const
+static inline Vector3 eval_segment(CurveType type, int num_cp, const Vector4 &prev,
+		const Vector4 &a, const Vector4 &b, const Vector4 &next, float t)
 {
-	int num_cp = size();
-
-	if(t < 0.0) t = 0.0;
-	if(t > 1.0) t = 1.0;
-
 	Vector4 res;
 	if(type == CURVE_LINEAR || num_cp == 2) {
-		res = lerp(cp[a], cp[b], t);
+		res = lerp(a, b, t);
 	} else {
-		int prev = a <= 0 ? a : a - 1;
-		int next = b >= num_cp - 1 ? b : b + 1;
-
 		if(type == CURVE_HERMITE) {
-			res = catmull_rom_spline(cp[prev], cp[a], cp[b], cp[next], t);
+			res = catmull_rom_spline(prev, a, b, next, t);
 		} else {
-			res = bspline(cp[prev], cp[a], cp[b], cp[next], t);
+			res = bspline(prev, a, b, next, t);
 			if(res.w != 0.0f) {
 				res.x /= res.w;
 				res.y /= res.w;
@@ -398,6 +364,191 @@ Vector3 Curve::interpolate_segment(int a, int b, float t) const
 	return Vector3(res.x, res.y, res.z);
 }
 
+/* polynomial coefficients (constant term first) of the homogeneous segment
+ * a-b. Only the b-spline is rational, the other curve types get w = 1.
+ */
+static void segment_coef(CurveType type, int num_cp, const Vector4 &prev,
+		const Vector4 &a, const Vector4 &b, const Vector4 &next, Vector4 *c)
+{
+	if(type == CURVE_LINEAR || num_cp == 2) {
+		c[0] = a;
+		c[1] = b - a;
+		c[2] = c[3] = Vector4(0, 0, 0, 0);
+	} else if(type == CURVE_HERMITE) {
+		c[0] = a;
+		c[1] = (b - prev) * 0.5f;
+		c[2] = prev - a * 2.5f + b * 2.0f - next * 0.5f;
+		c[3] = (a - b) * 1.5f + (next - prev) * 0.5f;
+	} else {
+		c[0] = (prev + a * 4.0f + b) * (1.0f / 6.0f);
+		c[1] = (b - prev) * 0.5f;
+		c[2] = (prev + b) * 0.5f - a;
+		c[3] = (a - b) * 0.5f + (next - prev) * (1.0f / 6.0f);
+		return;
+	}
+
+	c[0].w = 1.0f;
+	c[1].w = c[2].w = c[3].w = 0.0f;
+}
+
+static inline Vector3 eval_coef(const Vector4 *c, float t, bool rational)
+{
+	Vector4 res = ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+	if(rational && res.w != 0.0f) {
+		float s = 1.0f / res.w;
+		return Vector3(res.x * s, res.y * s, res.z * s);
+	}
+	return Vector3(res.x, res.y, res.z);
+}
+
+/* evaluators specialized by kind of segment polynomial, for loops over many
+ * samples of the same curve. The kind is selected once per curve (see
+ * Curve::eval_kind), instead of testing the curve type for every sample.
+ */
+enum {
+	EVAL_LINEAR,	// linear curves, and any curve with 2 control points
+	EVAL_CUBIC,		// hermite, and b-splines with all weights 1
+	EVAL_RATIONAL	// b-splines with other weights
+};
+
+template <int KIND>
+static inline Vector3 eval_coef(const Vector4 *c, float t)
+{
+	if(KIND == EVAL_LINEAR) {
+		Vector4 res = c[1] * t + c[0];
+		return Vector3(res.x, res.y, res.z);
+	}
+	return eval_coef(c, t, KIND == EVAL_RATIONAL);
+}
+
+// position and first derivative (with respect to the segment parameter)
+static inline Vector3 eval_coef_deriv(const Vector4 *c, float t, bool rational, Vector3 *deriv)
+{
+	Vector4 h = ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+	Vector4 dh = (c[3] * (3.0f * t) + c[2] * 2.0f) * t + c[1];
+
+	Vector3 pos = Vector3(h.x, h.y, h.z);
+	Vector3 d = Vector3(dh.x, dh.y, dh.z);
+	if(rational && h.w != 0.0f) {
+		// quotient rule: (H / w)' = (H' - (H / w) w') / w
+		float s = 1.0f / h.w;
+		pos = pos * s;
+		d = (d - pos * dh.w) * s;
+	}
+	*deriv = d;
+	return pos;
+}
+
+// position, first and second derivatives
+static inline Vector3 eval_coef_deriv2(const Vector4 *c, float t, bool rational,
+		Vector3 *deriv, Vector3 *deriv2)
+{
+	Vector4 h = ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+	Vector4 dh = (c[3] * (3.0f * t) + c[2] * 2.0f) * t + c[1];
+	Vector4 ddh = c[3] * (6.0f * t) + c[2] * 2.0f;
+
+	Vector3 pos = Vector3(h.x, h.y, h.z);
+	Vector3 d = Vector3(dh.x, dh.y, dh.z);
+	Vector3 dd = Vector3(ddh.x, ddh.y, ddh.z);
+	if(rational && h.w != 0.0f) {
+		float s = 1.0f / h.w;
+		pos = pos * s;
+		d = (d - pos * dh.w) * s;
+		dd = (dd - d * (2.0f * dh.w) - pos * ddh.w) * s;
+	}
+	*deriv = d;
+	*deriv2 = dd;
+	return pos;
+}
+
+void Curve::calc_coef() const
+{
+	int num_cp = (int)cp.size();
+	int nseg = std::max(num_cp - 1, 0);
+
+	std::vector<Vector4> *tab = new std::vector<Vector4>(nseg * 4);
+	coef.reset(tab);
+	coefrational = false;
+	if(nseg <= 0) {
+		coefvalid = true;
+		return;
+	}
+
+	// walk the control points in order, with the neighbours clamped at the ends
+	ChunkArray<Vector4>::const_iterator it = cp.begin();
+	Vector4 a = *it;
+	Vector4 b = *++it;
+	Vector4 prev = a;
+	++it;
+	bool weighted = false;
+	for(int i=0; i<nseg; i++) {
+		weighted = weighted || a.w != 1.0f;
+		Vector4 next = b;
+		if(i + 2 < num_cp) {
+			next = *it;
+			++it;
+		}
+		segment_coef(type, num_cp, prev, a, b, next, &(*tab)[i * 4]);
+		prev = a;
+		a = b;
+		b = next;
+	}
+	weighted = weighted || a.w != 1.0f;	// the last point
+
+	/* with all weights 1, the w polynomial of every b-spline segment is
+	 * exactly 1 (the basis functions sum to 1), so the division by w can be
+	 * skipped without changing the results
+	 */
+	coefrational = type == CURVE_BSPLINE && num_cp > 2 && weighted;
+	coefvalid = true;
+}
+
+const Vector4 *Curve::get_coef(int seg) const
+{
+	if(!coefvalid) {
+		calc_coef();
+	}
+	return coef->data() + seg * 4;
+}
+
+bool Curve::is_rational() const
+{
+	if(!coefvalid) {
+		calc_coef();
+	}
+	return coefrational;
+}
+
+int Curve::eval_kind() const
+{
+	if(type == CURVE_LINEAR || cp.size() <= 2) {
+		return EVAL_LINEAR;
+	}
+	return is_rational() ? EVAL_RATIONAL : EVAL_CUBIC;
+}
+
+int Curve::num_segments() const
+{
+	return std::max((int)cp.size() - 1, 0);
+}
+
+Vector3 Curve::interpolate_segment(int a, int b, float t) const
+{
+	int num_cp = size();
+
+	if(t < 0.0) t = 0.0;
+	if(t > 1.0) t = 1.0;
+
+	if(b == a + 1) {
+		return eval_coef(get_coef(a), t, is_rational());
+	}
+
+	int prev = a <= 0 ? a : a - 1;
+	int next = b >= num_cp - 1 ? b : b + 1;
+
+	return eval_segment(type, num_cp, cp[prev], cp[a], cp[b], cp[next], t);
+}
+
 Vector3 Curve::interpolate(float t) const
 {
 	if(empty()) {
@@ -409,6 +560,19 @@ Vector3 Curve::interpolate(float t) const
 		return Vector3(cp[0].x, cp[0].y, cp[0].z);
 	}
 
+	float segt;
+	int seg = find_segment(t, &segt);
+	return eval_coef(get_coef(seg), segt, is_rational());
+}
+
+int Curve::find_segment(float t, float *segt) const
+{
+	int num_cp = (int)cp.size();
+	if(num_cp < 2) {
+		*segt = 0.0f;
+		return 0;
+	}
+
 	if(t < 0.0) t = 0.0;
 	if(t > 1.0) t = 1.0;
 
@@ -420,8 +584,11 @@ Vector3 Curve::interpolate(float t) const
 	float t1 = (float)idx1 * dt;
 
 	t = (t - t0) / (t1 - t0);
+	if(t < 0.0) t = 0.0;
+	if(t > 1.0) t = 1.0;
 
-	return interpolate_segment(idx0, idx1, t);
+	*segt = t;
+	return idx0;
 }
 
 Vector2 Curve::interpolate2(float t) const
@@ -434,3 +601,806 @@ Vector3 Curve::operator ()(float t) const
 {
 	return interpolate(t);
 }
+
+template <int KIND>
+static void tess_range(const Vector4 *coef, int num_cp, int samples, int first, int count,
+		Vector3 *out)
+{
+	/* walk the segments in order, instead of searching for the segment of
+	 * each sample like interpolate does. The parameter arithmetic is kept
+	 * identical to interpolate, to produce exactly the same points.
+	 */
+	float dt = 1.0 / (float)(num_cp - 1);
+	int last = num_cp - 2;
+	float tstart = (float)first / (float)(samples - 1);
+	int idx0 = std::min((int)floor(tstart * (num_cp - 1)), last);
+	int seg = -1;
+	float t0 = 0.0f, t1 = 0.0f;
+	const Vector4 *c = 0;
+
+	for(int i=0; i<count; i++) {
+		float t = (float)(first + i) / (float)(samples - 1);
+
+		while(idx0 < last && t * (num_cp - 1) >= (float)(idx0 + 1)) {
+			++idx0;
+		}
+		if(idx0 != seg) {
+			seg = idx0;
+			t0 = (float)seg * dt;
+			t1 = (float)(seg + 1) * dt;
+			c = coef + seg * 4;
+		}
+
+		float st = (t - t0) / (t1 - t0);
+		if(st < 0.0) st = 0.0;
+		if(st > 1.0) st = 1.0;
+
+		out[i] = eval_coef<KIND>(c, st);
+	}
+}
+
+void Curve::tessellate(int samples, Vector3 *out) const
+{
+	tessellate_range(samples, 0, samples, out);
+}
+
+void Curve::tessellate_range(int samples, int first, int count, Vector3 *out) const
+{
+	if(samples <= 0 || count <= 0) return;
+
+	int num_cp = (int)cp.size();
+	if(num_cp <= 1 || samples == 1) {
+		Vector3 v = interpolate(0.0f);
+		for(int i=0; i<count; i++) {
+			out[i] = v;
+		}
+		return;
+	}
+
+	const Vector4 *coef = get_coef(0);
+	switch(eval_kind()) {
+	case EVAL_LINEAR:
+		tess_range<EVAL_LINEAR>(coef, num_cp, samples, first, count, out);
+		break;
+	case EVAL_CUBIC:
+		tess_range<EVAL_CUBIC>(coef, num_cp, samples, first, count, out);
+		break;
+	default:
+		tess_range<EVAL_RATIONAL>(coef, num_cp, samples, first, count, out);
+	}
+}
+
+void Curve::tessellate2(int samples, Vector2 *out) const
+{
+	const int chunk = 64;
+	Vector3 buf[chunk];
+
+	for(int i=0; i<samples; i+=chunk) {
+		int n = std::min(samples - i, chunk);
+		tessellate_range(samples, i, n, buf);
+		for(int j=0; j<n; j++) {
+			out[i + j] = Vector2(buf[j].x, buf[j].y);
+		}
+	}
+}
+
+// homogeneous cubic bezier control points from the polynomial coefficients
+static void coef_to_bezier(const Vector4 *c, Vector4 *bez)
+{
+	bez[0] = c[0];
+	bez[1] = c[0] + c[1] * (1.0f / 3.0f);
+	bez[2] = c[0] + (c[1] * 2.0f + c[2]) * (1.0f / 3.0f);
+	bez[3] = c[0] + c[1] + c[2] + c[3];
+}
+
+Bezier Curve::get_bezier(int seg) const
+{
+	Bezier bez;
+	coef_to_bezier(get_coef(seg), bez.cp);
+	return bez;
+}
+
+int Curve::to_bezier(std::vector<Bezier> *out) const
+{
+	int nseg = num_segments();
+	for(int i=0; i<nseg; i++) {
+		out->push_back(get_bezier(i));
+	}
+	return nseg;
+}
+
+int Curve::tessellate_adaptive(float tol, std::vector<Vector3> *out) const
+{
+	int num_cp = (int)cp.size();
+	if(num_cp <= 0) return 0;
+
+	out->push_back(interpolate(0.0f));
+	return tessellate_adaptive_range(tol, 0, num_cp - 1, out) + 1;
+}
+
+int Curve::tessellate_adaptive_range(float tol, int first_seg, int num_seg,
+		std::vector<Vector3> *out) const
+{
+	int nseg = num_segments();
+	if(first_seg < 0 || num_seg <= 0 || first_seg >= nseg) return 0;
+	num_seg = std::min(num_seg, nseg - first_seg);
+
+	if(eval_kind() == EVAL_LINEAR) {
+		// polylines are their own tessellation
+		for(int i=0; i<num_seg; i++) {
+			out->push_back(get_point3(first_seg + i + 1));
+		}
+		return num_seg;
+	}
+
+	/* the first vertex of each segment is the last vertex of the previous,
+	 * so only the vertices after the start point of each segment are added.
+	 */
+	size_t start = out->size();
+	for(int i=0; i<num_seg; i++) {
+		bezier_flatten(get_bezier(first_seg + i), tol, out);
+	}
+	return (int)(out->size() - start);
+}
+
+const std::vector<Vector3> &Curve::get_tessellation(float tol) const
+{
+	if(!tessvalid || tol != tess_tol) {
+		tess.clear();
+		tessellate_adaptive(tol, &tess);
+		tess_tol = tol;
+		tessvalid = true;
+	}
+	return tess;
+}
+
+bool Curve::has_tessellation(float tol) const
+{
+	return tessvalid && tess_tol == tol;
+}
+
+void Curve::set_tessellation(float tol, std::vector<Vector3> *verts)
+{
+	tess.swap(*verts);
+	tess_tol = tol;
+	tessvalid = true;
+}
+
+void Curve::prepare() const
+{
+	if(!bbvalid) {
+		calc_bounds();
+	}
+	if(!coefvalid) {
+		calc_coef();
+	}
+	if(!segbbvalid) {
+		calc_segment_bounds();
+	}
+	if(!arclenvalid) {
+		calc_arclen();
+	}
+}
+
+// ---- arc length ----
+
+#define ARCLEN_SUBDIV	4	// arc length table entries per segment
+
+// 5-point Gauss-Legendre quadrature nodes and weights on [0, 1]
+static const float gl_node[] = {
+	0.0469100770f, 0.2307653449f, 0.5f, 0.7692346551f, 0.9530899230f
+};
+static const float gl_weight[] = {
+	0.1184634425f, 0.2393143352f, 0.2844444444f, 0.2393143352f, 0.1184634425f
+};
+
+// length of the segment with coefficients c, from t0 to t1
+static float segment_length(const Vector4 *c, bool rational, float t0, float t1)
+{
+	float len = 0.0f;
+	float dt = t1 - t0;
+	for(int i=0; i<5; i++) {
+		Vector3 d;
+		eval_coef_deriv(c, t0 + gl_node[i] * dt, rational, &d);
+		len += gl_weight[i] * d.length();
+	}
+	return len * dt;
+}
+
+void Curve::calc_arclen() const
+{
+	int nseg = num_segments();
+	bool rational = is_rational();
+
+	std::vector<float> *tab = new std::vector<float>(nseg * ARCLEN_SUBDIV + 1);
+	arclen.reset(tab);
+	(*tab)[0] = 0.0f;
+
+	double sum = 0.0;
+	for(int i=0; i<nseg; i++) {
+		const Vector4 *c = get_coef(i);
+		for(int j=0; j<ARCLEN_SUBDIV; j++) {
+			float t0 = (float)j / (float)ARCLEN_SUBDIV;
+			float t1 = (float)(j + 1) / (float)ARCLEN_SUBDIV;
+			sum += segment_length(c, rational, t0, t1);
+			(*tab)[i * ARCLEN_SUBDIV + j + 1] = sum;
+		}
+	}
+	arclenvalid = true;
+}
+
+float Curve::length() const
+{
+	if(!arclenvalid) {
+		calc_arclen();
+	}
+	return arclen->back();
+}
+
+/* find the segment and segment parameter at arc length s: binary search in
+ * the arc length table, and then Newton iterations on the length integral,
+ * safeguarded by bisection.
+ */
+int Curve::length_to_segment(float s, float *segt) const
+{
+	if(!arclenvalid) {
+		calc_arclen();
+	}
+	const std::vector<float> &tab = *arclen;
+	float total = tab.back();
+	if(s <= 0.0f || total <= 0.0f) {
+		*segt = 0.0f;
+		return 0;
+	}
+	if(s >= total) {
+		*segt = 1.0f;
+		return num_segments() - 1;
+	}
+
+	int idx = std::upper_bound(tab.begin(), tab.end(), s) - tab.begin() - 1;
+	if(idx >= (int)tab.size() - 1) {
+		idx = tab.size() - 2;
+	}
+	int seg = idx / ARCLEN_SUBDIV;
+	const Vector4 *c = get_coef(seg);
+	bool rational = is_rational();
+
+	float lo = (float)(idx % ARCLEN_SUBDIV) / (float)ARCLEN_SUBDIV;
+	float hi = lo + 1.0f / (float)ARCLEN_SUBDIV;
+	float t0 = lo;
+	float rem = s - tab[idx];
+	float sublen = tab[idx + 1] - tab[idx];
+	if(sublen <= 0.0f) {
+		*segt = lo;
+		return seg;
+	}
+
+	float t = lo + (hi - lo) * rem / sublen;
+	float thres = total * 1e-6f;
+
+	for(int i=0; i<8; i++) {
+		float f = segment_length(c, rational, t0, t) - rem;
+		if(fabs(f) < thres) break;
+
+		if(f > 0.0f) {
+			hi = t;
+		} else {
+			lo = t;
+		}
+
+		Vector3 d;
+		eval_coef_deriv(c, t, rational, &d);
+		float speed = d.length();
+
+		float tnext = speed > 0.0f ? t - f / speed : lo - 1.0f;
+		if(tnext <= lo || tnext >= hi) {
+			tnext = (lo + hi) * 0.5f;	// newton step went outside the bracket
+		}
+		t = tnext;
+	}
+
+	*segt = t;
+	return seg;
+}
+
+float Curve::param_at_length(float s) const
+{
+	int nseg = num_segments();
+	if(nseg <= 0) return 0.0f;
+
+	float segt;
+	int seg = length_to_segment(s, &segt);
+	return ((float)seg + segt) / (float)nseg;
+}
+
+Vector3 Curve::interpolate_by_length(float s) const
+{
+	if(num_segments() <= 0) {
+		return interpolate(0.0f);
+	}
+
+	float segt;
+	int seg = length_to_segment(s, &segt);
+	return eval_coef(get_coef(seg), segt, is_rational());
+}
+
+// ---- polynomial root finding, exact bounds and closest point projection ----
+
+static float box_dist_sq(const Vector3 &p, const Vector3 &bmin, const Vector3 &bmax)
+{
+	float dsq = 0.0f;
+	for(int i=0; i<3; i++) {
+		float d = 0.0f;
+		if(p[i] < bmin[i]) {
+			d = bmin[i] - p[i];
+		} else if(p[i] > bmax[i]) {
+			d = p[i] - bmax[i];
+		}
+		dsq += d * d;
+	}
+	return dsq;
+}
+
+#define MAX_POLY_DEG		7
+#define ROOT_MAX_ITER		64
+
+static double poly_eval(const double *c, int deg, double t)
+{
+	double res = c[deg];
+	for(int i=deg-1; i>=0; i--) {
+		res = res * t + c[i];
+	}
+	return res;
+}
+
+/* find the root of a polynomial which is monotonic in [a, b], and changes
+ * sign in it. Newton iterations, falling back to bisection when a step leaves
+ * the bracket, so convergence is guaranteed.
+ */
+static double poly_root_bracketed(const double *c, const double *dc, int deg, double a, double b)
+{
+	double fa = poly_eval(c, deg, a);
+	double t = (a + b) * 0.5;
+
+	for(int i=0; i<ROOT_MAX_ITER; i++) {
+		double f = poly_eval(c, deg, t);
+		if(f == 0.0) break;
+
+		if((f < 0.0) == (fa < 0.0)) {
+			a = t;
+			fa = f;
+		} else {
+			b = t;
+		}
+
+		double df = poly_eval(dc, deg - 1, t);
+		double tnext = df != 0.0 ? t - f / df : a;
+		if(tnext <= a || tnext >= b) {
+			tnext = (a + b) * 0.5;
+		}
+		if(fabs(tnext - t) < 1e-12) {
+			t = tnext;
+			break;
+		}
+		t = tnext;
+	}
+	return t;
+}
+
+/* find all roots of a polynomial (coefficients constant term first) in
+ * [a, b]. The roots of the derivative split the interval into monotonic
+ * pieces, each of which contains at most one root. Returns the number of
+ * roots, in increasing order.
+ */
+static int poly_roots(const double *c, int deg, double a, double b, double *roots)
+{
+	while(deg > 0 && c[deg] == 0.0) {
+		--deg;
+	}
+	if(deg <= 0) return 0;
+
+	if(deg == 1) {
+		double t = -c[0] / c[1];
+		if(t >= a && t <= b) {
+			roots[0] = t;
+			return 1;
+		}
+		return 0;
+	}
+
+	double dc[MAX_POLY_DEG];
+	for(int i=1; i<=deg; i++) {
+		dc[i - 1] = c[i] * i;
+	}
+
+	double crit[MAX_POLY_DEG + 1];
+	int ncrit = poly_roots(dc, deg - 1, a, b, crit + 1);
+	crit[0] = a;
+	crit[ncrit + 1] = b;
+
+	int nroots = 0;
+	double f0 = poly_eval(c, deg, a);
+	for(int i=0; i<=ncrit; i++) {
+		double f1 = poly_eval(c, deg, crit[i + 1]);
+		if(f0 == 0.0) {
+			if(nroots == 0 || roots[nroots - 1] != crit[i]) {
+				roots[nroots++] = crit[i];
+			}
+		} else if(f1 != 0.0 && (f0 < 0.0) != (f1 < 0.0)) {
+			roots[nroots++] = poly_root_bracketed(c, dc, deg, crit[i], crit[i + 1]);
+		}
+		f0 = f1;
+	}
+	if(f0 == 0.0 && (nroots == 0 || roots[nroots - 1] != b)) {
+		roots[nroots++] = b;
+	}
+	return nroots;
+}
+
+// res = a * b, for polynomials of degree da and db
+static void poly_mul_add(const double *a, int da, const double *b, int db, double *res)
+{
+	for(int i=0; i<=da; i++) {
+		for(int j=0; j<=db; j++) {
+			res[i + j] += a[i] * b[j];
+		}
+	}
+}
+
+/* exact bounds of each segment, from the extrema of each coordinate: the
+ * roots of (x / w)' = (x' w - x w') / w^2, which is a polynomial of degree 4,
+ * or 2 for non-rational curves. Rational segments passing through w = 0 are
+ * unbounded.
+ */
+void Curve::calc_segment_bounds() const
+{
+	int nseg = num_segments();
+	bool rational = is_rational();
+	std::vector<Vector3> *tab = new std::vector<Vector3>(nseg * 2);
+	segbb.reset(tab);
+
+	if(nseg <= 0) {
+		cbbmin = cbbmax = empty() ? Vector3(0, 0, 0) : get_point3(0);
+		segbbvalid = true;
+		return;
+	}
+
+	cbbmin = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+	cbbmax = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for(int i=0; i<nseg; i++) {
+		const Vector4 *c = get_coef(i);
+		Vector3 bmin, bmax;
+
+		double w[4], dw[3];
+		for(int k=0; k<4; k++) {
+			w[k] = rational ? c[k].w : (k == 0 ? 1.0 : 0.0);
+		}
+		for(int k=0; k<3; k++) {
+			dw[k] = w[k + 1] * (k + 1);
+		}
+
+		double wroots[3];
+		if(rational && (w[0] == 0.0 || poly_roots(w, 3, 0.0, 1.0, wroots) > 0)) {
+			bmin = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			bmax = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+		} else {
+			bmin = bmax = eval_coef(c, 0.0f, rational);
+			Vector3 end = eval_coef(c, 1.0f, rational);
+
+			for(int j=0; j<3; j++) {
+				if(end[j] < bmin[j]) bmin[j] = end[j];
+				if(end[j] > bmax[j]) bmax[j] = end[j];
+
+				double x[4], dx[3];
+				for(int k=0; k<4; k++) {
+					x[k] = c[k][j];
+				}
+				for(int k=0; k<3; k++) {
+					dx[k] = x[k + 1] * (k + 1);
+				}
+
+				// the degree 5 terms cancel out
+				double num[6] = {0};
+				poly_mul_add(dx, 2, w, 3, num);
+				if(rational) {
+					double tmp[6] = {0};
+					poly_mul_add(x, 3, dw, 2, tmp);
+					for(int k=0; k<5; k++) {
+						num[k] -= tmp[k];
+					}
+				}
+
+				double roots[4];
+				int nroots = poly_roots(num, rational ? 4 : 2, 0.0, 1.0, roots);
+				for(int k=0; k<nroots; k++) {
+					float v = eval_coef(c, (float)roots[k], rational)[j];
+					if(v < bmin[j]) bmin[j] = v;
+					if(v > bmax[j]) bmax[j] = v;
+				}
+			}
+		}
+
+		(*tab)[i * 2] = bmin;
+		(*tab)[i * 2 + 1] = bmax;
+		for(int j=0; j<3; j++) {
+			if(bmin[j] < cbbmin[j]) cbbmin[j] = bmin[j];
+			if(bmax[j] > cbbmax[j]) cbbmax[j] = bmax[j];
+		}
+	}
+	segbbvalid = true;
+}
+
+void Curve::get_curve_bbox(Vector3 *bbmin, Vector3 *bbmax) const
+{
+	if(!segbbvalid) {
+		calc_segment_bounds();
+	}
+	*bbmin = cbbmin;
+	*bbmax = cbbmax;
+}
+
+void Curve::get_segment_bbox(int seg, Vector3 *bbmin, Vector3 *bbmax) const
+{
+	if(!segbbvalid) {
+		calc_segment_bounds();
+	}
+	*bbmin = (*segbb)[seg * 2];
+	*bbmax = (*segbb)[seg * 2 + 1];
+}
+
+/* find the nearest point to p on a segment. The squared distance is
+ * extremal where g(t) = (C(t) - p) . C'(t) = 0. With C = X / w this is, up
+ * to the positive factor 1 / w^3, the polynomial
+ * (X - p w) . (X' w - X w'), of degree 7 (degree 5 for non-rational curves).
+ * All its roots in [0, 1] and the segment endpoints are the candidates.
+ */
+static float proj_segment(const Vector4 *c, bool rational, const Vector3 &p, float *distsq_ret)
+{
+	double g[MAX_POLY_DEG + 1] = {0};
+	int deg;
+
+	double w[4], dw[3];
+	for(int i=0; i<4; i++) {
+		w[i] = rational ? c[i].w : (i == 0 ? 1.0 : 0.0);
+	}
+	for(int i=0; i<3; i++) {
+		dw[i] = w[i + 1] * (i + 1);
+	}
+
+	for(int j=0; j<3; j++) {
+		double x[4], dx[3], pa[4];
+		for(int i=0; i<4; i++) {
+			x[i] = c[i][j];
+			pa[i] = x[i] - p[j] * w[i];
+		}
+		for(int i=0; i<3; i++) {
+			dx[i] = x[i + 1] * (i + 1);
+		}
+
+		if(rational) {
+			// X' w - X w' (the degree 5 terms cancel out)
+			double pb[6] = {0};
+			poly_mul_add(dx, 2, w, 3, pb);
+			double tmp[6] = {0};
+			poly_mul_add(x, 3, dw, 2, tmp);
+			for(int i=0; i<6; i++) {
+				pb[i] -= tmp[i];
+			}
+			poly_mul_add(pa, 3, pb, 4, g);
+		} else {
+			poly_mul_add(pa, 3, dx, 2, g);
+		}
+	}
+	deg = rational ? 7 : 5;
+
+	double roots[MAX_POLY_DEG];
+	int nroots = poly_roots(g, deg, 0.0, 1.0, roots);
+
+	float best_t = 0.0f;
+	float best_dsq = (eval_coef(c, 0.0f, rational) - p).length_sq();
+
+	float dsq = (eval_coef(c, 1.0f, rational) - p).length_sq();
+	if(dsq < best_dsq) {
+		best_dsq = dsq;
+		best_t = 1.0f;
+	}
+
+	for(int i=0; i<nroots; i++) {
+		float t = (float)roots[i];
+		dsq = (eval_coef(c, t, rational) - p).length_sq();
+		if(dsq < best_dsq) {
+			best_dsq = dsq;
+			best_t = t;
+		}
+	}
+
+	*distsq_ret = best_dsq;
+	return best_t;
+}
+
+float Curve::proj_param(const Vector3 &p) const
+{
+	int nseg = num_segments();
+	if(nseg <= 0) {
+		return 0.0f;
+	}
+
+	if(!segbbvalid) {
+		calc_segment_bounds();
+	}
+	bool rational = is_rational();
+	const Vector3 *bb = segbb->data();
+
+	// start from the segment with the nearest bounds, to reject more of the rest
+	int first = 0;
+	float first_bdist = FLT_MAX;
+	for(int i=0; i<nseg; i++) {
+		float bdist = box_dist_sq(p, bb[i * 2], bb[i * 2 + 1]);
+		if(bdist < first_bdist) {
+			first_bdist = bdist;
+			first = i;
+		}
+	}
+
+	float best_dsq;
+	float best_segt = proj_segment(get_coef(first), rational, p, &best_dsq);
+	int best_seg = first;
+
+	for(int i=0; i<nseg; i++) {
+		if(i == first || box_dist_sq(p, bb[i * 2], bb[i * 2 + 1]) >= best_dsq) {
+			continue;
+		}
+
+		float dsq;
+		float segt = proj_segment(get_coef(i), rational, p, &dsq);
+		if(dsq < best_dsq) {
+			best_dsq = dsq;
+			best_segt = segt;
+			best_seg = i;
+		}
+	}
+
+	return ((float)best_seg + best_segt) / (float)nseg;
+}
+
+float Curve::segment_dist_sq(int seg, const Vector3 &p) const
+{
+	float dsq;
+	proj_segment(get_coef(seg), is_rational(), p, &dsq);
+	return dsq;
+}
+
+// ---- derivatives ----
+
+Vector3 Curve::deriv(float t) const
+{
+	int nseg = num_segments();
+	if(nseg <= 0) {
+		return Vector3(0, 0, 0);
+	}
+
+	float segt;
+	int seg = find_segment(t, &segt);
+
+	Vector3 d;
+	eval_coef_deriv(get_coef(seg), segt, is_rational(), &d);
+	return d * (float)nseg;	// chain rule: dsegt/dt = nseg
+}
+
+Vector3 Curve::deriv2(float t) const
+{
+	int nseg = num_segments();
+	if(nseg <= 0) {
+		return Vector3(0, 0, 0);
+	}
+
+	float segt;
+	int seg = find_segment(t, &segt);
+
+	Vector3 d, dd;
+	eval_coef_deriv2(get_coef(seg), segt, is_rational(), &d, &dd);
+	return dd * (float)(nseg * nseg);
+}
+
+/* fill in the frame from the position and the derivatives. prev_normal is
+ * used for straight parts of the curve, where the normal is undefined.
+ */
+static void calc_frame(const Vector3 &pos, const Vector3 &d, const Vector3 &dd,
+		const Vector3 &prev_normal, CurveFrame *frm)
+{
+	frm->pos = pos;
+
+	float speed = d.length();
+	if(speed <= 0.0f) {
+		frm->tangent = frm->normal = Vector3(0, 0, 0);
+		frm->curvature = 0.0f;
+		return;
+	}
+	Vector3 tang = d / speed;
+	frm->tangent = tang;
+	frm->curvature = cross_product(d, dd).length() / (speed * speed * speed);
+
+	// component of the acceleration perpendicular to the tangent
+	Vector3 n = dd - tang * dot_product(dd, tang);
+	float nlen = n.length();
+	if(nlen > 1e-6f * dd.length() && nlen > 0.0f) {
+		frm->normal = n / nlen;
+		return;
+	}
+
+	// straight: keep the previous normal if possible, or use the in-plane normal
+	n = prev_normal - tang * dot_product(prev_normal, tang);
+	nlen = n.length();
+	if(nlen > 1e-6f) {
+		frm->normal = n / nlen;
+	} else {
+		n = Vector3(-tang.y, tang.x, 0.0f);
+		nlen = n.length();
+		frm->normal = nlen > 0.0f ? n / nlen : Vector3(1, 0, 0);
+	}
+}
+
+CurveFrame Curve::eval_frame(float t) const
+{
+	CurveFrame frm;
+	int nseg = num_segments();
+	if(nseg <= 0) {
+		calc_frame(interpolate(0.0f), Vector3(0, 0, 0), Vector3(0, 0, 0), Vector3(0, 0, 0), &frm);
+		return frm;
+	}
+
+	float segt;
+	int seg = find_segment(t, &segt);
+
+	Vector3 d, dd;
+	Vector3 pos = eval_coef_deriv2(get_coef(seg), segt, is_rational(), &d, &dd);
+	calc_frame(pos, d * (float)nseg, dd * (float)(nseg * nseg), Vector3(0, 0, 0), &frm);
+	return frm;
+}
+
+void Curve::eval_frames(int samples, CurveFrame *out) const
+{
+	if(samples <= 0) return;
+
+	int nseg = num_segments();
+	if(nseg <= 0 || samples == 1) {
+		for(int i=0; i<samples; i++) {
+			out[i] = eval_frame(0.0f);
+		}
+		return;
+	}
+
+	bool rational = is_rational();
+	float dscale = (float)nseg;
+	float ddscale = (float)(nseg * nseg);
+	Vector3 prev_normal = Vector3(0, 0, 0);
+
+	// walk the segments in order, like tessellate_range
+	float dt = 1.0 / (float)nseg;
+	int seg = 0;
+	float t0 = 0.0f, t1 = dt;
+	const Vector4 *c = get_coef(0);
+
+	for(int i=0; i<samples; i++) {
+		float t = (float)i / (float)(samples - 1);
+
+		if(seg < nseg - 1 && t * nseg >= (float)(seg + 1)) {
+			while(seg < nseg - 1 && t * nseg >= (float)(seg + 1)) {
+				++seg;
+			}
+			t0 = (float)seg * dt;
+			t1 = (float)(seg + 1) * dt;
+			c = get_coef(seg);
+		}
+
+		float st = (t - t0) / (t1 - t0);
+		if(st < 0.0) st = 0.0;
+		if(st > 1.0) st = 1.0;
+
+		Vector3 d, dd;
+		Vector3 pos = eval_coef_deriv2(c, st, rational, &d, &dd);
+		calc_frame(pos, d * dscale, dd * ddscale, prev_normal, out + i);
+		prev_normal = out[i].normal;
+	}
+}
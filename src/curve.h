@@ -19,7 +19,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define CURVE_H_
 
 #include <vector>
+#include <atomic>
+#include <memory>
 #include <vmath/vmath.h>
+#include "bezier.h"
+#include "chunkarray.h"
 
 enum CurveType {
 	CURVE_LINEAR,
@@ -27,17 +31,80 @@ enum CurveType {
 	CURVE_BSPLINE
 };
 
+// position and local frame of a point on the curve (see Curve::eval_frames)
+struct CurveFrame {
+	Vector3 pos;
+	Vector3 tangent;	// unit tangent
+	Vector3 normal;		// unit normal, towards the center of curvature
+	float curvature;	// 1 / radius of curvature
+};
+
+// code path used by Curve::interpolate_batch
+enum BatchMode {
+	BATCH_AUTO,		// best available on this processor
+	BATCH_SCALAR,
+	BATCH_SSE2,
+	BATCH_AVX2
+};
+
 class Curve {
 private:
-	std::vector<Vector4> cp;
+	/* chunked, so that inserting or removing control points doesn't move all
+	 * the rest in long curves (see chunkarray.h)
+	 */
+	ChunkArray<Vector4> cp;
 	CurveType type;
 
+	unsigned int version;	// incremented on every modification
+
 	// bounding box
 	mutable Vector3 bbmin, bbmax;
 	mutable bool bbvalid;
 
+	/* polynomial coefficients of each segment, 4 homogeneous vectors per
+	 * segment, constant term first. Calculated lazily like the bounds.
+	 *
+	 * This and the other tables below are shared with the snapshots of the
+	 * curve (see CurveSnapshot), so they are never modified in place: a new
+	 * table replaces the old one every time it's recalculated.
+	 */
+	mutable std::shared_ptr<std::vector<Vector4> > coef;
+	mutable bool coefvalid;
+	mutable bool coefrational;	// b-spline with weights other than 1 (see is_rational)
+
+	/* cumulative arc length table, with a few entries per segment, calculated
+	 * lazily by Gauss-Legendre quadrature.
+	 */
+	mutable std::shared_ptr<std::vector<float> > arclen;
+	mutable bool arclenvalid;
+
+	// exact bounds of the curve, and of each segment (min/max pairs)
+	mutable Vector3 cbbmin, cbbmax;
+	mutable std::shared_ptr<std::vector<Vector3> > segbb;
+	mutable bool segbbvalid;
+
+	// cached adaptive tessellation (see get_tessellation)
+	mutable std::vector<Vector3> tess;
+	mutable float tess_tol;
+	mutable bool tessvalid;
+
+	static std::atomic<BatchMode> batch_mode;	// read by any thread evaluating curves
+
 	void calc_bounds() const;
 	void inval_bounds() const;
+	void invalidate();	// called by every operation modifying the curve
+
+	void calc_coef() const;
+	const Vector4 *get_coef(int seg) const;
+	bool is_rational() const;	// true if evaluation involves division by w (weighted b-splines)
+	int eval_kind() const;		// specialized evaluator to use (see curve.cc)
+
+	int find_segment(float t, float *segt) const;
+	void calc_segment_bounds() const;
+	void calc_arclen() const;
+	int length_to_segment(float s, float *segt) const;
+
+	friend class CurveSnapshot;	// copies the curve without the stale caches
 
 public:
 	Curve(CurveType type = CURVE_HERMITE);
@@ -48,6 +115,11 @@ public:
 	void set_type(CurveType type);
 	CurveType get_type() const;
 
+	/* the version changes every time the curve is modified, and can be used
+	 * to keep track of changes by anything caching data derived from it.
+	 */
+	unsigned int get_version() const;
+
 	void add_point(const Vector4 &p);
 	void add_point(const Vector3 &p, float weight = 1.0f);
 	void add_point(const Vector2 &p, float weight = 1.0f);
@@ -59,8 +131,10 @@ public:
 	void clear();		// remove all control points
 	bool empty() const;	// true if 0 control points
 	int size() const;	// returns number of control points
-	// access operators for control points
-	Vector4 &operator [](int idx);
+	/* access operators for control points. They are read-only, so that reads
+	 * don't invalidate the caches: modify points with set_point, set_weight
+	 * or move_point.
+	 */
 	const Vector4 &operator [](int idx) const;
 	const Vector4 &get_point(int idx) const;
 
@@ -82,25 +156,134 @@ public:
 	/* get_bbox returns the axis-aligned bounding box of the curve's
 	 * control points.
 	 * NOTE: hermite curves can go outside of the bounding box of their control points
-	 * NOTE: lazy calculation of bounds is performed, use calc_bbox in multithreaded programs
+	 * NOTE: lazy calculation of bounds is performed, use calc_bbox or prepare in multithreaded programs
 	 */
 	void get_bbox(Vector3 *bbmin, Vector3 *bbmax) const;
 	void calc_bbox(Vector3 *bbmin, Vector3 *bbmax) const;
+	/* get_curve_bbox returns the exact bounding box of the curve itself,
+	 * calculated from the extrema of each segment. Rational segments passing
+	 * through w = 0 are unbounded (+/- FLT_MAX).
+	 * NOTE: lazy calculation, same multithreading caveat as get_bbox
+	 */
+	void get_curve_bbox(Vector3 *bbmin, Vector3 *bbmax) const;
+	void get_segment_bbox(int seg, Vector3 *bbmin, Vector3 *bbmax) const;
 	// normalize the curve's bounds to coincide with the unit cube
 	void normalize();
 
-	// project a point to the curve (nearest point on the curve)
-	float proj_param(const Vector3 &p, float refine_thres = 0.01) const;
-	Vector3 proj_point(const Vector3 &p, float refine_thres = 0.01) const;
+	/* project a point to the curve (nearest point on the curve). Each segment
+	 * which can be closer than the best found so far is solved analytically,
+	 * to full precision (there's no refinement threshold anymore).
+	 */
+	float proj_param(const Vector3 &p) const;
+	Vector3 proj_point(const Vector3 &p) const;
 	// equivalent to (proj_point(p) - p).length()
 	float distance(const Vector3 &p) const;
 	// equivalent to fabs((proj_point(p) - p).length_sq())
 	float distance_sq(const Vector3 &p) const;
+	// squared distance of p from segment seg (solved exactly, like proj_param)
+	float segment_dist_sq(int seg, const Vector3 &p) const;
+
+	int num_segments() const;	// number of control points - 1 (or 0)
+
+	/* simplify removes control points while the curve stays within tol of
+	 * the original, checked both ways at a few points per segment. The end
+	 * points are always kept. Works for all curve types (see curvesimplify.cc).
+	 * Returns the fraction of the control points removed, in [0, 1).
+	 */
+	float simplify(float tol);
 
 	Vector3 interpolate_segment(int a, int b, float t) const;
 	Vector3 interpolate(float t) const;
 	Vector2 interpolate2(float t) const;
 	Vector3 operator ()(float t) const;
+
+	/* first and second derivatives with respect to t. Rational b-splines are
+	 * differentiated with the quotient rule.
+	 */
+	Vector3 deriv(float t) const;
+	Vector3 deriv2(float t) const;
+
+	/* eval_frame returns the position, tangent, normal and curvature at t.
+	 * Where the curve is straight, the normal is perpendicular to the
+	 * tangent on the z=0 plane. eval_frames evaluates frames at samples
+	 * points, uniformly spaced in t like tessellate, in one pass over the
+	 * segments; on straight parts it carries over the previous normal.
+	 */
+	CurveFrame eval_frame(float t) const;
+	void eval_frames(int samples, CurveFrame *out) const;
+
+	/* arc length parameterization. interpolate(t) moves uniformly in control
+	 * point index, interpolate_by_length(s) moves with constant speed, where s
+	 * is the distance along the curve in [0, length()].
+	 * NOTE: same multithreading caveat as get_bbox.
+	 */
+	float length() const;
+	float param_at_length(float s) const;	// value of t at arc length s
+	Vector3 interpolate_by_length(float s) const;
+
+	/* tessellate evaluates the curve at samples points, uniformly spaced in t,
+	 * walking the segments in order. The output is identical to calling
+	 * interpolate(i / (samples - 1)) for each sample (t = 0 if samples is 1).
+	 * out must have room for samples points.
+	 */
+	void tessellate(int samples, Vector3 *out) const;
+	void tessellate2(int samples, Vector2 *out) const;
+	// evaluate samples [first, first + count) out of the same sequence as above
+	void tessellate_range(int samples, int first, int count, Vector3 *out) const;
+
+	/* interpolate_batch evaluates the curve at count arbitrary parameter
+	 * values, and writes the results in structure-of-arrays form. z may be
+	 * null for 2D curves. Uses SSE2 or AVX2 where available (see curvesimd.cc).
+	 */
+	void interpolate_batch(const float *t, int count, float *x, float *y, float *z) const;
+	/* select the interpolate_batch code path for all curves, returns the
+	 * previous. Can be called while other threads evaluate curves, which
+	 * switch paths on their next call.
+	 */
+	static BatchMode set_batch_mode(BatchMode mode);
+
+	/* exact piecewise cubic bezier form of the curve, one per segment, in the
+	 * order of the segments. Only b-splines (with more than 2 control points)
+	 * give rational segments, all others have weights of 1. Polyline
+	 * segments become straight beziers. to_bezier appends the segments to out
+	 * and returns how many.
+	 */
+	Bezier get_bezier(int seg) const;
+	int to_bezier(std::vector<Bezier> *out) const;
+
+	/* tessellate_adaptive flattens the curve into a polyline, subdividing each
+	 * segment until it deviates from its chord by no more than tol (in world
+	 * units). The vertices are appended to out, and the
+	 * number of vertices produced is returned.
+	 */
+	int tessellate_adaptive(float tol, std::vector<Vector3> *out) const;
+	/* flatten segments [first_seg, first_seg + num_seg) the same way, and
+	 * append their vertices after the first. Concatenating the ranges of all
+	 * segments after the start point gives the same result as
+	 * tessellate_adaptive, which allows splitting long curves across threads.
+	 */
+	int tessellate_adaptive_range(float tol, int first_seg, int num_seg,
+			std::vector<Vector3> *out) const;
+	/* get_tessellation returns the result of tessellate_adaptive, which is
+	 * cached and only recalculated if the curve or the tolerance changes.
+	 * NOTE: same multithreading caveat as get_bbox.
+	 */
+	const std::vector<Vector3> &get_tessellation(float tol) const;
+	// true if get_tessellation(tol) would return the cached tessellation
+	bool has_tessellation(float tol) const;
+	/* install verts (swapped in) as the cached result of get_tessellation.
+	 * They must be the result of tessellate_adaptive(tol) of this curve
+	 * (see tessellate_scene).
+	 */
+	void set_tessellation(float tol, std::vector<Vector3> *verts);
+
+	/* prepare calculates all the lazily evaluated data up front (bounds,
+	 * segment coefficients, arc length table). Until the curve is modified,
+	 * the const member functions, except get_tessellation, then only read
+	 * the curve and can be called from multiple threads at once.
+	 * See also CurveSnapshot.
+	 */
+	void prepare() const;
 };
 
 #endif	// CURVE_H_
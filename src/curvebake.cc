@@ -0,0 +1,257 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <algorithm>
+#include "curvebake.h"
+
+#define BAKE_ERR_STEPS	8	// points checked per table interval
+
+// float to half float, rounding to nearest even
+static baked_u16 float_to_half(float f)
+{
+	baked_u32 x;
+	memcpy(&x, &f, 4);
+
+	baked_u32 sign = (x >> 16) & 0x8000;
+	int fexp = (int)((x >> 23) & 0xff);
+	baked_u32 mant = x & 0x7fffff;
+
+	if(fexp == 0xff) {
+		return sign | 0x7c00 | (mant ? 0x200 : 0);	// inf or nan
+	}
+	int exp = fexp - 127 + 15;
+	if(exp >= 31) {
+		return sign | 0x7c00;
+	}
+
+	if(exp <= 0) {
+		// denormal
+		if(exp < -10) return sign;
+		mant |= 0x800000;
+		int shift = 14 - exp;
+		baked_u32 h = mant >> shift;
+		baked_u32 rem = mant & ((1u << shift) - 1);
+		baked_u32 half = 1u << (shift - 1);
+		if(rem > half || (rem == half && (h & 1))) {
+			++h;
+		}
+		return sign | h;
+	}
+
+	// a carry out of the mantissa correctly bumps the exponent
+	baked_u32 h = ((baked_u32)exp << 10) | (mant >> 13);
+	baked_u32 rem = mant & 0x1fff;
+	if(rem > 0x1000 || (rem == 0x1000 && (h & 1))) {
+		++h;
+	}
+	return sign | h;
+}
+
+static void put_u16(unsigned char *p, baked_u16 x)
+{
+	p[0] = x & 0xff;
+	p[1] = x >> 8;
+}
+
+static void put_u32(unsigned char *p, baked_u32 x)
+{
+	for(int i=0; i<4; i++) {
+		p[i] = (x >> (i * 8)) & 0xff;
+	}
+}
+
+static void put_f32(unsigned char *p, float f)
+{
+	baked_u32 x;
+	memcpy(&x, &f, 4);
+	put_u32(p, x);
+}
+
+// point of the curve at table position t (see baked_eval)
+static Vector3 bake_point(const Curve *curve, BakeSpacing spacing, float length, float t)
+{
+	if(spacing == BAKE_ARC_LENGTH) {
+		return curve->interpolate_by_length(t * length);
+	}
+	return curve->interpolate(t);
+}
+
+bool bake_curve(const Curve *curve, int samples, BakeSpacing spacing, BakeFormat format,
+		int dim, BakedCurve *res)
+{
+	if(curve->empty() || samples < 2 || dim < 2 || dim > 3) {
+		return false;
+	}
+
+	res->format = format;
+	res->spacing = spacing;
+	res->dim = dim;
+	res->samples = samples;
+	res->length = curve->length();
+
+	std::vector<Vector3> pts(samples);
+	if(spacing == BAKE_UNIFORM_T) {
+		curve->tessellate(samples, &pts[0]);
+	} else {
+		for(int i=0; i<samples; i++) {
+			pts[i] = bake_point(curve, spacing, res->length, (float)i / (float)(samples - 1));
+		}
+	}
+
+	Vector3 bmin = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vector3 bmax = -bmin;
+	for(int i=0; i<samples; i++) {
+		for(int j=0; j<3; j++) {
+			bmin[j] = std::min(bmin[j], pts[i][j]);
+			bmax[j] = std::max(bmax[j], pts[i][j]);
+		}
+	}
+
+	for(int i=0; i<3; i++) {
+		float ext = bmax[i] - bmin[i];
+		switch(format) {
+		case BAKE_FLOAT16:
+			res->offset[i] = (bmin[i] + bmax[i]) * 0.5f;
+			res->scale[i] = ext > 0.0f ? ext * 0.5f : 1.0f;
+			break;
+
+		case BAKE_FIXED16:
+			res->offset[i] = bmin[i];
+			res->scale[i] = ext > 0.0f ? ext / 65535.0f : 1.0f;
+			break;
+
+		case BAKE_FLOAT32:
+		default:
+			res->offset[i] = 0.0f;
+			res->scale[i] = 1.0f;
+		}
+		if(i >= dim) {
+			res->offset[i] = 0.0f;
+			res->scale[i] = 0.0f;
+		}
+	}
+
+	int vsize = format == BAKE_FLOAT32 ? 4 : 2;
+	res->data.resize(samples * dim * vsize);
+	unsigned char *dptr = &res->data[0];
+
+	for(int i=0; i<samples; i++) {
+		for(int j=0; j<dim; j++) {
+			float x = (pts[i][j] - res->offset[j]) / res->scale[j];
+
+			switch(format) {
+			case BAKE_FLOAT16:
+				put_u16(dptr, float_to_half(x));
+				break;
+
+			case BAKE_FIXED16:
+				x = floor(x + 0.5f);
+				put_u16(dptr, (baked_u16)std::max(0.0f, std::min(x, 65535.0f)));
+				break;
+
+			case BAKE_FLOAT32:
+			default:
+				put_f32(dptr, x);
+			}
+			dptr += vsize;
+		}
+	}
+
+	// measure the error of the table, as seen by the reader
+	baked_curve bc;
+	bc.format = format;
+	bc.dim = dim;
+	bc.spacing = spacing;
+	bc.samples = samples;
+	for(int i=0; i<3; i++) {
+		bc.offset[i] = res->offset[i];
+		bc.scale[i] = res->scale[i];
+	}
+	bc.data = &res->data[0];
+
+	float max_err_sq = 0.0f;
+	int nsteps = (samples - 1) * BAKE_ERR_STEPS;
+	for(int i=0; i<=nsteps; i++) {
+		float t = (float)i / (float)nsteps;
+		float v[3] = {0, 0, 0};
+		baked_eval(&bc, t, v);
+
+		Vector3 p = i % BAKE_ERR_STEPS ? bake_point(curve, spacing, res->length, t) :
+			pts[i / BAKE_ERR_STEPS];
+		if(dim < 3) p.z = 0.0f;
+
+		float err_sq = (p - Vector3(v[0], v[1], v[2])).length_sq();
+		max_err_sq = std::max(max_err_sq, err_sq);
+	}
+	res->max_error = sqrt(max_err_sq);
+	return true;
+}
+
+bool save_baked(const char *fname, const BakedCurve *baked, int count)
+{
+	FILE *fp = fopen(fname, "wb");
+	if(!fp) return false;
+
+	bool res = save_baked(fp, baked, count);
+	fclose(fp);
+	return res;
+}
+
+bool save_baked(FILE *fp, const BakedCurve *baked, int count)
+{
+	unsigned char buf[BAKED_DESC_SIZE];
+
+	memcpy(buf, "CBAK", 4);
+	put_u32(buf + 4, BAKED_VERSION);
+	put_u32(buf + 8, count);
+	fwrite(buf, 1, BAKED_HEADER_SIZE, fp);
+
+	// tables follow the descriptors, each starting at a multiple of 4
+	baked_u32 offs = BAKED_HEADER_SIZE + count * BAKED_DESC_SIZE;
+	for(int i=0; i<count; i++) {
+		const BakedCurve *bc = baked + i;
+
+		memset(buf, 0, sizeof buf);
+		buf[0] = bc->format;
+		buf[1] = bc->dim;
+		buf[2] = bc->spacing;
+		put_u32(buf + 4, bc->samples);
+		put_u32(buf + 8, offs);
+		for(int j=0; j<3; j++) {
+			put_f32(buf + 12 + j * 4, bc->offset[j]);
+			put_f32(buf + 24 + j * 4, bc->scale[j]);
+		}
+		put_f32(buf + 36, bc->max_error);
+		put_f32(buf + 40, bc->length);
+		fwrite(buf, 1, BAKED_DESC_SIZE, fp);
+
+		offs += (bc->data.size() + 3) & ~3;
+	}
+
+	static const unsigned char pad[4] = {0, 0, 0, 0};
+	for(int i=0; i<count; i++) {
+		const std::vector<unsigned char> &data = baked[i].data;
+		if(!data.empty()) {
+			fwrite(&data[0], 1, data.size(), fp);
+		}
+		fwrite(pad, 1, ((data.size() + 3) & ~3) - data.size(), fp);
+	}
+	return !ferror(fp);
+}
@@ -0,0 +1,63 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CURVEBAKE_H_
+#define CURVEBAKE_H_
+
+#include <stdio.h>
+#include <vector>
+#include "curve.h"
+#include "bakedcurve.h"
+
+// same values as the BAKED_* constants of the reader (bakedcurve.h)
+enum BakeFormat {
+	BAKE_FLOAT32 = BAKED_FLOAT32,
+	BAKE_FLOAT16 = BAKED_FLOAT16,	// normalized to [-1, 1] in the bounding box
+	BAKE_FIXED16 = BAKED_FIXED16	// normalized to [0, 65535] in the bounding box
+};
+
+enum BakeSpacing {
+	BAKE_UNIFORM_T = BAKED_UNIFORM_T,
+	BAKE_ARC_LENGTH = BAKED_ARC_LENGTH
+};
+
+// a curve sampled into a table, for playback with bakedcurve.h
+struct BakedCurve {
+	BakeFormat format;
+	BakeSpacing spacing;
+	int dim;			// 2 (xy) or 3 (xyz)
+	int samples;
+	float offset[3], scale[3];	// position = offset + scale * stored value
+	float max_error;	// max distance of the interpolated table from the curve
+	float length;		// arc length of the curve
+	std::vector<unsigned char> data;	// the table, little-endian
+};
+
+/* bake_curve samples the curve at samples points, uniformly spaced in t or
+ * in arc length, and quantizes them in the bounding box of the samples.
+ * The error is measured between the curve and the linear interpolation of
+ * the quantized table (as done by baked_eval), at BAKE_ERR_STEPS points per
+ * interval. Returns false if the curve is empty or the arguments are invalid.
+ */
+bool bake_curve(const Curve *curve, int samples, BakeSpacing spacing, BakeFormat format,
+		int dim, BakedCurve *res);
+
+// write the tables in the format described in bakedcurve.h
+bool save_baked(const char *fname, const BakedCurve *baked, int count);
+bool save_baked(FILE *fp, const BakedCurve *baked, int count);
+
+#endif	// CURVEBAKE_H_
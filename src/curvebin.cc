@@ -0,0 +1,503 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "curvebin.h"
+
+#if defined(unix) || defined(__unix__) || defined(__APPLE__)
+#define USE_MMAP
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define HEADER_SIZE		64
+#define CURVE_ENTRY_SIZE	16
+#define NURBS_ENTRY_SIZE	32
+#define CP_ALIGN		16
+
+// the control points are accessed in place, as arrays of Vector4
+static_assert(sizeof(Vector4) == 16, "Vector4 must be 4 floats");
+
+static const char magic[] = "GCURVESB";
+
+static bool little_endian()
+{
+	uint32_t x = 1;
+	return *(unsigned char*)&x == 1;
+}
+
+static uint32_t get_u32(const unsigned char *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_u64(const unsigned char *p)
+{
+	return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+static void put_u32(unsigned char *p, uint32_t x)
+{
+	for(int i=0; i<4; i++) {
+		p[i] = (x >> (i * 8)) & 0xff;
+	}
+}
+
+static void put_u64(unsigned char *p, uint64_t x)
+{
+	put_u32(p, (uint32_t)x);
+	put_u32(p + 4, (uint32_t)(x >> 32));
+}
+
+// adler-32, with the modulo deferred as long as the sums can't overflow
+#define ADLER_MOD	65521
+#define ADLER_NMAX	5552
+
+static uint32_t adler32(uint32_t adler, const unsigned char *buf, size_t len)
+{
+	uint32_t a = adler & 0xffff;
+	uint32_t b = adler >> 16;
+
+	while(len > 0) {
+		size_t n = len < ADLER_NMAX ? len : ADLER_NMAX;
+		len -= n;
+		while(n--) {
+			a += *buf++;
+			b += a;
+		}
+		a %= ADLER_MOD;
+		b %= ADLER_MOD;
+	}
+	return (b << 16) | a;
+}
+
+/* the file is written twice: first without a file, only to compute the
+ * checksum of the data, then for real.
+ */
+struct BinWriter {
+	FILE *fp;
+	uint32_t adler;
+	uint64_t offs;
+};
+
+static void bin_write(BinWriter *w, const void *data, size_t size)
+{
+	if(w->fp) {
+		fwrite(data, 1, size, w->fp);
+	} else {
+		w->adler = adler32(w->adler, (const unsigned char*)data, size);
+	}
+	w->offs += size;
+}
+
+static void bin_pad(BinWriter *w, int align)
+{
+	static const unsigned char zeros[CP_ALIGN] = {0};
+	int pad = (int)((align - w->offs % align) % align);
+	bin_write(w, zeros, pad);
+}
+
+static uint64_t align_up(uint64_t x, int align)
+{
+	return (x + align - 1) / align * align;
+}
+
+#define CP_BATCH	256
+
+static void write_data(BinWriter *w, const Curve * const *curves, int count,
+		const Nurbs * const *nurbs, int nurbs_count)
+{
+	unsigned char entry[NURBS_ENTRY_SIZE];
+
+	uint64_t first_cp = 0;
+	for(int i=0; i<count; i++) {
+		put_u32(entry, (uint32_t)curves[i]->get_type());
+		put_u32(entry + 4, curves[i]->size());
+		put_u64(entry + 8, first_cp);
+		bin_write(w, entry, CURVE_ENTRY_SIZE);
+		first_cp += curves[i]->size();
+	}
+
+	uint64_t first_knot = 0;
+	for(int i=0; i<nurbs_count; i++) {
+		put_u32(entry, nurbs[i]->get_degree());
+		put_u32(entry + 4, nurbs[i]->num_knots());
+		put_u32(entry + 8, nurbs[i]->size());
+		put_u32(entry + 12, 0);
+		put_u64(entry + 16, first_knot);
+		put_u64(entry + 24, first_cp);
+		bin_write(w, entry, NURBS_ENTRY_SIZE);
+		first_knot += nurbs[i]->num_knots();
+		first_cp += nurbs[i]->size();
+	}
+
+	bin_pad(w, CP_ALIGN);
+
+	// control points, written in batches
+	float batch[CP_BATCH * 4];
+	int nbatch = 0;
+	for(int i=0; i<count + nurbs_count; i++) {
+		int num = i < count ? curves[i]->size() : nurbs[i - count]->size();
+		for(int j=0; j<num; j++) {
+			float *v = batch + nbatch * 4;
+			const Vector4 &cp = i < count ? curves[i]->get_point(j) :
+				nurbs[i - count]->get_homog_point(j);
+			v[0] = cp.x; v[1] = cp.y; v[2] = cp.z; v[3] = cp.w;
+			if(++nbatch >= CP_BATCH) {
+				bin_write(w, batch, sizeof batch);
+				nbatch = 0;
+			}
+		}
+	}
+	bin_write(w, batch, nbatch * 4 * sizeof *batch);
+
+	for(int i=0; i<nurbs_count; i++) {
+		for(int j=0; j<nurbs[i]->num_knots(); j++) {
+			float k = nurbs[i]->get_knot(j);
+			bin_write(w, &k, sizeof k);
+		}
+	}
+}
+
+bool save_curves_bin(const char *fname, const Curve * const *curves, int count,
+		const Nurbs * const *nurbs, int nurbs_count)
+{
+	FILE *fp = fopen(fname, "wb");
+	if(!fp) return false;
+
+	bool res = save_curves_bin(fp, curves, count, nurbs, nurbs_count);
+	if(fclose(fp) != 0) {
+		res = false;
+	}
+	return res;
+}
+
+bool save_curves_bin(FILE *fp, const Curve * const *curves, int count,
+		const Nurbs * const *nurbs, int nurbs_count)
+{
+	if(!little_endian()) {
+		fprintf(stderr, "save_curves_bin: binary curve files need a little-endian host\n");
+		return false;
+	}
+
+	uint64_t num_cp = 0, num_knots = 0;
+	for(int i=0; i<count; i++) {
+		num_cp += curves[i]->size();
+	}
+	for(int i=0; i<nurbs_count; i++) {
+		num_cp += nurbs[i]->size();
+		num_knots += nurbs[i]->num_knots();
+	}
+
+	uint64_t cp_offs = align_up(HEADER_SIZE + (uint64_t)count * CURVE_ENTRY_SIZE +
+			(uint64_t)nurbs_count * NURBS_ENTRY_SIZE, CP_ALIGN);
+	uint64_t knot_offs = cp_offs + num_cp * 16;
+
+	BinWriter w;
+	w.fp = 0;
+	w.adler = 1;
+	w.offs = HEADER_SIZE;
+	write_data(&w, curves, count, nurbs, nurbs_count);
+
+	unsigned char hdr[HEADER_SIZE];
+	memset(hdr, 0, sizeof hdr);
+	memcpy(hdr, magic, 8);
+	put_u32(hdr + 8, CURVEBIN_VERSION);
+	put_u32(hdr + 12, HEADER_SIZE);
+	put_u32(hdr + 16, count);
+	put_u32(hdr + 20, nurbs_count);
+	put_u64(hdr + 24, num_cp);
+	put_u64(hdr + 32, num_knots);
+	put_u64(hdr + 40, cp_offs);
+	put_u64(hdr + 48, knot_offs);
+	put_u32(hdr + 56, w.adler);
+
+	if(fwrite(hdr, 1, HEADER_SIZE, fp) != HEADER_SIZE) {
+		return false;
+	}
+	w.fp = fp;
+	w.offs = HEADER_SIZE;
+	write_data(&w, curves, count, nurbs, nurbs_count);
+	return !ferror(fp);
+}
+
+bool is_curves_bin(const char *fname)
+{
+	FILE *fp = fopen(fname, "rb");
+	if(!fp) return false;
+
+	char buf[8];
+	bool res = fread(buf, 1, 8, fp) == 8 && memcmp(buf, magic, 8) == 0;
+	fclose(fp);
+	return res;
+}
+
+std::list<Curve*> load_curves_bin(const char *fname, std::list<Nurbs*> *nurbs)
+{
+	std::list<Curve*> curves;
+	CurveBinFile file;
+	if(!file.open(fname)) {
+		fprintf(stderr, "load_curves_bin: failed to load %s\n", fname);
+		return curves;
+	}
+
+	for(int i=0; i<file.num_curves(); i++) {
+		curves.push_back(file.get_curve(i));
+	}
+
+	std::list<Nurbs*> nurbs_read;
+	for(int i=0; i<file.num_nurbs(); i++) {
+		if(!nurbs) {
+			fprintf(stderr, "load_curves_bin: skipping nurbs curve\n");
+			continue;
+		}
+		Nurbs *n = file.get_nurbs(i);
+		if(!n) {
+			fprintf(stderr, "load_curves_bin: invalid nurbs curve\n");
+			std::list<Curve*>::iterator it = curves.begin();
+			while(it != curves.end()) {
+				delete *it++;
+			}
+			curves.clear();
+
+			std::list<Nurbs*>::iterator nit = nurbs_read.begin();
+			while(nit != nurbs_read.end()) {
+				delete *nit++;
+			}
+			return curves;
+		}
+		nurbs_read.push_back(n);
+	}
+
+	if(nurbs) {
+		nurbs->splice(nurbs->end(), nurbs_read);
+	}
+	return curves;
+}
+
+CurveBinFile::CurveBinFile()
+{
+	data = 0;
+	size = 0;
+	map_addr = 0;
+	buf = 0;
+	ncurves = nnurbs = 0;
+}
+
+CurveBinFile::~CurveBinFile()
+{
+	close();
+}
+
+bool CurveBinFile::open(const char *fname, bool verify)
+{
+	close();
+
+#ifdef USE_MMAP
+	int fd = ::open(fname, O_RDONLY);
+	if(fd == -1) {
+		return false;
+	}
+	struct stat st;
+	if(fstat(fd, &st) == -1 || st.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+	size = st.st_size;
+	void *addr = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(addr == MAP_FAILED) {
+		size = 0;
+		return false;
+	}
+	map_addr = addr;
+	data = (const unsigned char*)addr;
+#else
+	FILE *fp = fopen(fname, "rb");
+	if(!fp) {
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	long fsize = ftell(fp);
+	rewind(fp);
+	if(fsize <= 0 || !(buf = (unsigned char*)malloc(fsize))) {
+		fclose(fp);
+		return false;
+	}
+	size = fsize;
+	if(fread(buf, 1, size, fp) != size) {
+		fclose(fp);
+		close();
+		return false;
+	}
+	fclose(fp);
+	data = buf;
+#endif
+
+	if(!validate(verify)) {
+		fprintf(stderr, "CurveBinFile: invalid or corrupted file: %s\n", fname);
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool CurveBinFile::open(const void *mem, size_t size, bool verify)
+{
+	close();
+	data = (const unsigned char*)mem;
+	this->size = size;
+
+	if(!validate(verify)) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void CurveBinFile::close()
+{
+#ifdef USE_MMAP
+	if(map_addr) {
+		munmap(map_addr, size);
+	}
+#endif
+	free(buf);
+	map_addr = 0;
+	buf = 0;
+	data = 0;
+	size = 0;
+	ncurves = nnurbs = 0;
+}
+
+// checks that all tables and ranges are within the file
+bool CurveBinFile::validate(bool verify_checksum)
+{
+	if(!little_endian() || size < HEADER_SIZE || memcmp(data, magic, 8) != 0 ||
+			get_u32(data + 8) != CURVEBIN_VERSION || get_u32(data + 12) != HEADER_SIZE) {
+		return false;
+	}
+
+	uint64_t count = get_u32(data + 16);
+	uint64_t nurbs_count = get_u32(data + 20);
+	uint64_t num_cp = get_u64(data + 24);
+	uint64_t num_knots = get_u64(data + 32);
+	uint64_t cp_offs = get_u64(data + 40);
+	uint64_t knot_offs = get_u64(data + 48);
+
+	uint64_t tab_end = HEADER_SIZE + count * CURVE_ENTRY_SIZE + nurbs_count * NURBS_ENTRY_SIZE;
+	if(count > INT32_MAX || nurbs_count > INT32_MAX || tab_end > cp_offs ||
+			cp_offs % CP_ALIGN != 0 || cp_offs > size || num_cp > (size - cp_offs) / 16 ||
+			knot_offs != cp_offs + num_cp * 16 || num_knots > (size - knot_offs) / 4) {
+		return false;
+	}
+
+	ncurves = (int)count;
+	nnurbs = (int)nurbs_count;
+
+	for(int i=0; i<ncurves; i++) {
+		const unsigned char *ent = curve_entry(i);
+		uint64_t ncp = get_u32(ent + 4);
+		uint64_t first = get_u64(ent + 8);
+		if(get_u32(ent) > CURVE_BSPLINE || ncp > INT32_MAX || first > num_cp || ncp > num_cp - first) {
+			return false;
+		}
+	}
+	for(int i=0; i<nnurbs; i++) {
+		const unsigned char *ent = nurbs_entry(i);
+		uint64_t nknots = get_u32(ent + 4);
+		uint64_t ncp = get_u32(ent + 8);
+		uint64_t first_knot = get_u64(ent + 16);
+		uint64_t first_cp = get_u64(ent + 24);
+		if(nknots > INT32_MAX || ncp > INT32_MAX || first_knot > num_knots ||
+				nknots > num_knots - first_knot || first_cp > num_cp || ncp > num_cp - first_cp) {
+			return false;
+		}
+	}
+
+	if(verify_checksum) {
+		uint32_t adler = adler32(1, data + HEADER_SIZE, size - HEADER_SIZE);
+		if(adler != get_u32(data + 56)) {
+			fprintf(stderr, "CurveBinFile: checksum mismatch\n");
+			return false;
+		}
+	}
+	return true;
+}
+
+const unsigned char *CurveBinFile::curve_entry(int idx) const
+{
+	return data + HEADER_SIZE + idx * CURVE_ENTRY_SIZE;
+}
+
+const unsigned char *CurveBinFile::nurbs_entry(int idx) const
+{
+	return data + HEADER_SIZE + ncurves * CURVE_ENTRY_SIZE + idx * NURBS_ENTRY_SIZE;
+}
+
+int CurveBinFile::num_curves() const
+{
+	return ncurves;
+}
+
+CurveType CurveBinFile::get_curve_type(int idx) const
+{
+	return (CurveType)get_u32(curve_entry(idx));
+}
+
+int CurveBinFile::get_curve_size(int idx) const
+{
+	return (int)get_u32(curve_entry(idx) + 4);
+}
+
+const Vector4 *CurveBinFile::get_curve_points(int idx) const
+{
+	const Vector4 *cp = (const Vector4*)(data + get_u64(data + 40));
+	return cp + get_u64(curve_entry(idx) + 8);
+}
+
+Curve *CurveBinFile::get_curve(int idx) const
+{
+	return new Curve(get_curve_points(idx), get_curve_size(idx), get_curve_type(idx));
+}
+
+int CurveBinFile::num_nurbs() const
+{
+	return nnurbs;
+}
+
+Nurbs *CurveBinFile::get_nurbs(int idx) const
+{
+	const unsigned char *ent = nurbs_entry(idx);
+	int degree = (int)get_u32(ent);
+	int nknots = (int)get_u32(ent + 4);
+	int ncp = (int)get_u32(ent + 8);
+
+	const Vector4 *cp = (const Vector4*)(data + get_u64(data + 40)) + get_u64(ent + 24);
+	const float *knots = (const float*)(data + get_u64(data + 48)) + get_u64(ent + 16);
+
+	Nurbs *nurbs = new Nurbs;
+	if(!nurbs->set_homog(degree, knots, nknots, cp, ncp)) {
+		delete nurbs;
+		return 0;
+	}
+	return nurbs;
+}
@@ -0,0 +1,112 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CURVEBIN_H_
+#define CURVEBIN_H_
+
+#include <stdio.h>
+#include <stddef.h>
+#include <list>
+#include "curve.h"
+#include "nurbs.h"
+
+/* Binary curve files (GCURVESB), the binary sibling of the GCURVES text
+ * format, holding the same curves and nurbs curves. All values are
+ * little-endian, and every table is aligned to its element size.
+ *
+ *	 0  magic "GCURVESB"
+ *	 8  u32 version (1)
+ *	12  u32 header size (64)
+ *	16  u32 number of curves
+ *	20  u32 number of nurbs curves
+ *	24  u64 total number of control points
+ *	32  u64 total number of knots
+ *	40  u64 offset of the control point block (multiple of 16)
+ *	48  u64 offset of the knot block
+ *	56  u32 adler-32 checksum of everything after the header
+ *	60  u32 reserved (0)
+ *	64  curve table, 16 bytes per curve:
+ *		u32 type (0: polyline, 1: hermite, 2: bspline), u32 number of
+ *		control points, u64 index of the first control point in the block
+ *	..  nurbs table, 32 bytes per nurbs curve:
+ *		u32 degree, u32 number of knots, u32 number of control points,
+ *		u32 reserved, u64 index of the first knot, u64 index of the first
+ *		control point
+ *	..  control point block: x y z w floats for every control point
+ *	..  knot block: floats
+ *
+ * Nurbs control points are stored in homogeneous form (x w, y w, z w, w), as
+ * Nurbs holds them, so that they are read back exactly.
+ */
+#define CURVEBIN_VERSION	1
+
+bool save_curves_bin(const char *fname, const Curve * const *curves, int count,
+		const Nurbs * const *nurbs = 0, int nurbs_count = 0);
+bool save_curves_bin(FILE *fp, const Curve * const *curves, int count,
+		const Nurbs * const *nurbs = 0, int nurbs_count = 0);
+
+// true if the file starts with the binary curve file magic
+bool is_curves_bin(const char *fname);
+
+/* load_curves_bin reads all curves of a binary file, like load_curves for
+ * text files (which calls it for binary files).
+ */
+std::list<Curve*> load_curves_bin(const char *fname, std::list<Nurbs*> *nurbs = 0);
+
+/* read-only view of a binary curve file. The file is mapped in memory where
+ * possible (or read in one go), and the control points are accessed in
+ * place, so binary files can only be written and read on little-endian hosts.
+ */
+class CurveBinFile {
+private:
+	const unsigned char *data;
+	size_t size;
+	void *map_addr;		// mapping, if the file is mapped
+	unsigned char *buf;	// copy of the file, if it was read
+	int ncurves, nnurbs;
+
+	CurveBinFile(const CurveBinFile&);
+	CurveBinFile &operator =(const CurveBinFile&);
+
+	const unsigned char *curve_entry(int idx) const;
+	const unsigned char *nurbs_entry(int idx) const;
+	bool validate(bool verify_checksum);
+
+public:
+	CurveBinFile();
+	~CurveBinFile();
+
+	/* open checks the layout of the file, and the checksum if verify is true,
+	 * which reads the whole file.
+	 */
+	bool open(const char *fname, bool verify = true);
+	// use a file already in memory, which must outlive this object
+	bool open(const void *mem, size_t size, bool verify = true);
+	void close();
+
+	int num_curves() const;
+	CurveType get_curve_type(int idx) const;
+	int get_curve_size(int idx) const;
+	// the control points of curve idx, in the file (16-byte aligned if mapped)
+	const Vector4 *get_curve_points(int idx) const;
+	Curve *get_curve(int idx) const;	// new Curve with a copy of the points
+
+	int num_nurbs() const;
+	Nurbs *get_nurbs(int idx) const;	// null if the nurbs curve is invalid
+};
+
+#endif	// CURVEBIN_H_
@@ -18,21 +18,26 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdlib.h>
 #include <ctype.h>
 #include <string>
+#include <vector>
 #include "curvefile.h"
+#include "curvebin.h"
 
 static bool save_curve(FILE *fp, const Curve *curve);
+static bool save_nurbs(FILE *fp, const Nurbs *nurbs);
 
-bool save_curves(const char *fname, const Curve * const *curves, int count)
+bool save_curves(const char *fname, const Curve * const *curves, int count,
+		const Nurbs * const *nurbs, int nurbs_count)
 {
 	FILE *fp = fopen(fname, "wb");
 	if(!fp) return false;
 
-	bool res = save_curves(fp, curves, count);
+	bool res = save_curves(fp, curves, count, nurbs, nurbs_count);
 	fclose(fp);
 	return res;
 }
 
-bool save_curves(FILE *fp, const Curve * const *curves, int count)
+bool save_curves(FILE *fp, const Curve * const *curves, int count,
+		const Nurbs * const *nurbs, int nurbs_count)
 {
 	fprintf(fp, "GCURVES\n");
 
@@ -41,6 +46,11 @@ bool save_curves(FILE *fp, const Curve * const *curves, int count)
 			return false;
 		}
 	}
+	for(int i=0; i<nurbs_count; i++) {
+		if(!save_nurbs(fp, nurbs[i])) {
+			return false;
+		}
+	}
 	return true;
 }
 
@@ -64,19 +74,86 @@ static bool save_curve(FILE *fp, const Curve *curve)
 	fprintf(fp, "    cpcount %d\n", curve->size());
 	for(int i=0; i<curve->size(); i++) {
 		Vector4 cp = curve->get_point(i);
-		fprintf(fp, "    cp %g %g %g %g\n", cp.x, cp.y, cp.z, cp.w);
+		fprintf(fp, "    cp %.9g %.9g %.9g %.9g\n", cp.x, cp.y, cp.z, cp.w);
 	}
 	fprintf(fp, "}\n");
 	return true;
 }
 
+static bool save_nurbs(FILE *fp, const Nurbs *nurbs)
+{
+	fprintf(fp, "nurbs {\n");
+	fprintf(fp, "    degree %d\n", nurbs->get_degree());
+	fprintf(fp, "    knotcount %d\n", nurbs->num_knots());
+	for(int i=0; i<nurbs->num_knots(); i++) {
+		fprintf(fp, "    knot %.9g\n", nurbs->get_knot(i));
+	}
+	fprintf(fp, "    cpcount %d\n", nurbs->size());
+	/* weighted control points are written in homogeneous form, as stored,
+	 * since converting them to positions and back may change the last bit
+	 */
+	for(int i=0; i<nurbs->size(); i++) {
+		const Vector4 &cp = nurbs->get_homog_point(i);
+		if(cp.w == 1.0f) {
+			fprintf(fp, "    cp %.9g %.9g %.9g 1\n", cp.x, cp.y, cp.z);
+		} else {
+			fprintf(fp, "    hcp %.9g %.9g %.9g %.9g\n", cp.x, cp.y, cp.z, cp.w);
+		}
+	}
+	fprintf(fp, "}\n");
+	return true;
+}
+
+bool save_bezier(const char *fname, const Curve * const *curves, int count)
+{
+	FILE *fp = fopen(fname, "wb");
+	if(!fp) return false;
+
+	bool res = save_bezier(fp, curves, count);
+	fclose(fp);
+	return res;
+}
+
+bool save_bezier(FILE *fp, const Curve * const *curves, int count)
+{
+	fprintf(fp, "GBEZIER\n");
+
+	for(int i=0; i<count; i++) {
+		int nseg = curves[i]->num_segments();
+
+		fprintf(fp, "bezier {\n");
+		fprintf(fp, "    rational %d\n", curves[i]->get_type() == CURVE_BSPLINE && nseg > 1 ? 1 : 0);
+		fprintf(fp, "    segcount %d\n", nseg);
+		for(int j=0; j<nseg; j++) {
+			Bezier bez = curves[i]->get_bezier(j);
+			fprintf(fp, "    seg");
+			for(int k=0; k<4; k++) {
+				Vector3 p = bezier_point(bez, k);
+				fprintf(fp, "  %.9g %.9g %.9g %.9g", p.x, p.y, p.z, bezier_weight(bez, k));
+			}
+			fputc('\n', fp);
+		}
+		fprintf(fp, "}\n");
+	}
+	return !ferror(fp);
+}
+
 std::list<Curve*> load_curves(const char *fname)
+{
+	return load_curves(fname, 0);
+}
+
+std::list<Curve*> load_curves(const char *fname, std::list<Nurbs*> *nurbs)
 {
 	std::list<Curve*> res;
+	if(is_curves_bin(fname)) {
+		return load_curves_bin(fname, nurbs);
+	}
+
 	FILE *fp = fopen(fname, "r");
 	if(!fp) return res;
 
-	res = load_curves(fp);
+	res = load_curves(fp, nurbs);
 	fclose(fp);
 	return res;
 }
@@ -120,7 +197,7 @@ static bool expect_float(FILE *fp, float *ret)
 	std::string tok = next_token(fp);
 	const char *cs = tok.c_str();
 	char *endp;
-	*ret = strtod(cs, &endp);
+	*ret = strtof(cs, &endp);
 	if(endp != cs + tok.length()) {
 		if(!(tok.empty() && feof(fp))) {
 			fprintf(stderr, "number expected\n");
@@ -145,9 +222,10 @@ static bool expect_int(FILE *fp, int *ret)
 	return true;
 }
 
+// the "curve" keyword has already been read by load_curves
 static Curve *curve_block(FILE *fp)
 {
-	if(!expect_str(fp, "curve") || !expect_str(fp, "{")) {
+	if(!expect_str(fp, "{")) {
 		return 0;
 	}
 
@@ -195,27 +273,170 @@ err:
 	return 0;
 }
 
+// the "nurbs" keyword has already been read by load_curves
+static Nurbs *nurbs_block(FILE *fp)
+{
+	if(!expect_str(fp, "{")) {
+		return 0;
+	}
+
+	int degree = -1, knotcount = -1, cpcount = -1;
+	std::vector<float> knots;
+	std::vector<Vector4> cp;
+	Nurbs *nurbs = 0;
+
+	std::string tok;
+	while(!(tok = next_token(fp)).empty() && tok != "}") {
+		if(tok == "degree") {
+			if(degree != -1 || !expect_int(fp, &degree) || degree <= 0) {
+				goto err;
+			}
+		} else if(tok == "knotcount") {
+			if(knotcount != -1 || !expect_int(fp, &knotcount) || knotcount <= 0) {
+				goto err;
+			}
+		} else if(tok == "cpcount") {
+			if(cpcount != -1 || !expect_int(fp, &cpcount) || cpcount <= 0) {
+				goto err;
+			}
+		} else if(tok == "knot") {
+			float u;
+			if(!expect_float(fp, &u)) {
+				goto err;
+			}
+			knots.push_back(u);
+		} else {
+			// position and weight, or homogeneous (x w, y w, z w, w)
+			if(tok != "cp" && tok != "hcp") {
+				goto err;
+			}
+			Vector4 v;
+			for(int i=0; i<4; i++) {
+				if(!expect_float(fp, &v[i])) {
+					goto err;
+				}
+			}
+			if(tok == "cp") {
+				v.x *= v.w;
+				v.y *= v.w;
+				v.z *= v.w;
+			}
+			cp.push_back(v);
+		}
+	}
+
+	if((int)knots.size() != knotcount) {
+		fprintf(stderr, "warning: nurbs knotcount was %d, but read %d knots\n", knotcount, (int)knots.size());
+	}
+	if((int)cp.size() != cpcount) {
+		fprintf(stderr, "warning: nurbs cpcount was %d, but read %d control points\n", cpcount, (int)cp.size());
+	}
+
+	nurbs = new Nurbs;
+	if(degree == -1 || knots.empty() || cp.empty() ||
+			!nurbs->set_homog(degree, &knots[0], (int)knots.size(), &cp[0], (int)cp.size())) {
+		fprintf(stderr, "invalid nurbs curve: degree %d, %d knots, %d control points\n",
+				degree, (int)knots.size(), (int)cp.size());
+		goto err;
+	}
+	return nurbs;
+err:
+	fprintf(stderr, "failed to parse nurbs block\n");
+	delete nurbs;
+	return 0;
+}
+
 std::list<Curve*> load_curves(FILE *fp)
+{
+	return load_curves(fp, 0);
+}
+
+std::list<Curve*> load_curves(FILE *fp, std::list<Nurbs*> *nurbs)
 {
 	std::list<Curve*> curves;
+	std::list<Nurbs*> nurbs_read;
 	if(!expect_str(fp, "GCURVES")) {
 		fprintf(stderr, "load_curves: failed to load, invalid file format\n");
 		return curves;
 	}
 
-	Curve *curve;
-	while((curve = curve_block(fp))) {
-		curves.push_back(curve);
+	bool failed = false;
+	std::string tok;
+	while(!(tok = next_token(fp)).empty()) {
+		if(tok == "curve") {
+			Curve *curve = curve_block(fp);
+			if(!curve) {
+				failed = true;
+				break;
+			}
+			curves.push_back(curve);
+
+		} else if(tok == "nurbs") {
+			Nurbs *n = nurbs_block(fp);
+			if(!n) {
+				failed = true;
+				break;
+			}
+			if(nurbs) {
+				nurbs_read.push_back(n);
+			} else {
+				fprintf(stderr, "load_curves: skipping nurbs curve\n");
+				delete n;
+			}
+
+		} else {
+			fprintf(stderr, "load_curves: unexpected token: %s\n", tok.c_str());
+			failed = true;
+			break;
+		}
 	}
 
-	if(!feof(fp)) {
+	if(failed || !feof(fp)) {
 		std::list<Curve*>::iterator it = curves.begin();
 		while(it != curves.end()) {
 			delete *it++;
 		}
+		curves.clear();
+
+		std::list<Nurbs*>::iterator nit = nurbs_read.begin();
+		while(nit != nurbs_read.end()) {
+			delete *nit++;
+		}
 		return curves;
 	}
 
+	if(nurbs) {
+		nurbs->splice(nurbs->end(), nurbs_read);
+	}
 	return curves;
 }
 
+
+bool convert_curves(const char *infile, const char *outfile, bool binary)
+{
+	std::list<Nurbs*> nlist;
+	std::list<Curve*> clist = load_curves(infile, &nlist);
+	if(clist.empty() && nlist.empty()) {
+		return false;
+	}
+
+	std::vector<Curve*> curves(clist.begin(), clist.end());
+	std::vector<Nurbs*> nurbs(nlist.begin(), nlist.end());
+	const Curve * const *cptr = curves.empty() ? 0 : &curves[0];
+	const Nurbs * const *nptr = nurbs.empty() ? 0 : &nurbs[0];
+
+	bool res;
+	if(binary) {
+		res = save_curves_bin(outfile, cptr, (int)curves.size(), nptr, (int)nurbs.size());
+	} else {
+		res = save_curves(outfile, cptr, (int)curves.size(), nptr, (int)nurbs.size());
+	}
+
+	for(size_t i=0; i<curves.size(); i++) {
+		delete curves[i];
+	}
+	for(size_t i=0; i<nurbs.size(); i++) {
+		delete nurbs[i];
+	}
+	return res;
+}
@@ -21,11 +21,36 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdio.h>
 #include <list>
 #include "curve.h"
+#include "nurbs.h"
 
-bool save_curves(const char *fname, const Curve * const *curves, int count);
-bool save_curves(FILE *fp, const Curve * const *curves, int count);
+bool save_curves(const char *fname, const Curve * const *curves, int count,
+		const Nurbs * const *nurbs = 0, int nurbs_count = 0);
+bool save_curves(FILE *fp, const Curve * const *curves, int count,
+		const Nurbs * const *nurbs = 0, int nurbs_count = 0);
 
+/* save_bezier exports the curves in piecewise cubic bezier form (see
+ * Curve::get_bezier), as "bezier" blocks with one "seg" line per segment,
+ * listing 4 control points as positions and weights (x y z w).
+ */
+bool save_bezier(const char *fname, const Curve * const *curves, int count);
+bool save_bezier(FILE *fp, const Curve * const *curves, int count);
+
+/* load_curves returns the curves of the file. Files can also have nurbs
+ * curves, which are appended to the nurbs list if given, or skipped.
+ * load_curves(fname) reads both the text format and the binary format
+ * (see curvebin.h). The text format is written with enough digits to read
+ * back the same values.
+ */
 std::list<Curve*> load_curves(const char *fname);
+std::list<Curve*> load_curves(const char *fname, std::list<Nurbs*> *nurbs);
 std::list<Curve*> load_curves(FILE *fp);
+std::list<Curve*> load_curves(FILE *fp, std::list<Nurbs*> *nurbs);
+
+/* convert_curves converts a curve file of either format to the binary format
+ * if binary is true, or to the text format otherwise. Both formats store the
+ * values exactly as held in memory, so conversions in either direction are
+ * lossless.
+ */
+bool convert_curves(const char *infile, const char *outfile, bool binary);
 
 #endif	// CURVEFILE_H_
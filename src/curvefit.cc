@@ -0,0 +1,374 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* least squares curve fitting.
+ *
+ * A point of a curve with n control points is a weighted sum of at most 4
+ * consecutive control points (2 for polylines), with weights given by the
+ * basis functions of the curve type at its parameter. For m input points
+ * with parameters t_k, the least squares control points P solve the normal
+ * equations (A^T A) P = A^T X, where row k of A holds the weights at t_k.
+ * A^T A is symmetric positive definite with a half bandwidth of 3, so it's
+ * accumulated point by point in band storage, and solved by banded Cholesky
+ * factorization in O(n) time and memory, for x, y and z at once.
+ */
+#include <math.h>
+#include <algorithm>
+#include "curvefit.h"
+
+#define FIT_BAND	3	// half bandwidth of the normal equations
+#define FIT_STRIDE	(FIT_BAND + 1)
+#define FIT_REPARAM_ITER	2
+/* a little smoothing (second differences of the control points) keeps the
+ * system non-singular when some control points have no input points near
+ * them, without noticeably affecting the rest.
+ */
+#define FIT_SMOOTHING	1e-6
+#define FIT_START_CP	4
+
+// control point indices and weights at t, returns how many (up to 4)
+static int basis(CurveType type, int num_cp, float t, int *idx, float *w)
+{
+	float ft = t * (float)(num_cp - 1);
+	int seg = std::max(std::min((int)ft, num_cp - 2), 0);
+	float u = ft - (float)seg;
+
+	if(type == CURVE_LINEAR || num_cp == 2) {
+		idx[0] = seg;
+		idx[1] = seg + 1;
+		w[0] = 1.0f - u;
+		w[1] = u;
+		return 2;
+	}
+
+	float u2 = u * u;
+	float u3 = u2 * u;
+	float bw[4];
+	if(type == CURVE_HERMITE) {
+		bw[0] = 0.5f * (2.0f * u2 - u - u3);
+		bw[1] = 0.5f * (2.0f - 5.0f * u2 + 3.0f * u3);
+		bw[2] = 0.5f * (u + 4.0f * u2 - 3.0f * u3);
+		bw[3] = 0.5f * (u3 - u2);
+	} else {
+		float iu = 1.0f - u;
+		bw[0] = iu * iu * iu * (1.0f / 6.0f);
+		bw[1] = (3.0f * u3 - 6.0f * u2 + 4.0f) * (1.0f / 6.0f);
+		bw[2] = (3.0f * (u + u2 - u3) + 1.0f) * (1.0f / 6.0f);
+		bw[3] = u3 * (1.0f / 6.0f);
+	}
+
+	// the neighbours of the end points are clamped, like in Curve::calc_coef
+	int cidx[4];
+	cidx[0] = seg > 0 ? seg - 1 : seg;
+	cidx[1] = seg;
+	cidx[2] = seg + 1;
+	cidx[3] = seg + 2 < num_cp ? seg + 2 : seg + 1;
+
+	int n = 0;
+	for(int i=0; i<4; i++) {
+		if(n > 0 && idx[n - 1] == cidx[i]) {
+			w[n - 1] += bw[i];
+		} else {
+			idx[n] = cidx[i];
+			w[n++] = bw[i];
+		}
+	}
+	return n;
+}
+
+static Vector3 eval_basis(CurveType type, const std::vector<Vector4> &cp, float t)
+{
+	int idx[4];
+	float w[4];
+	int n = basis(type, (int)cp.size(), t, idx, w);
+
+	Vector3 res = Vector3(0, 0, 0);
+	for(int i=0; i<n; i++) {
+		const Vector4 &p = cp[idx[i]];
+		res += Vector3(p.x, p.y, p.z) * w[i];
+	}
+	return res;
+}
+
+// in-place banded cholesky factorization (A = U^T U), false if not positive definite
+static bool band_cholesky(double *mat, int n)
+{
+	for(int i=0; i<n; i++) {
+		int kstart = std::max(i - FIT_BAND, 0);
+		int jend = std::min(i + FIT_BAND, n - 1);
+
+		double s = mat[i * FIT_STRIDE];
+		for(int k=kstart; k<i; k++) {
+			double u = mat[k * FIT_STRIDE + i - k];
+			s -= u * u;
+		}
+		if(s <= 0.0) {
+			return false;
+		}
+		double diag = sqrt(s);
+		mat[i * FIT_STRIDE] = diag;
+
+		for(int j=i+1; j<=jend; j++) {
+			s = mat[i * FIT_STRIDE + j - i];
+			for(int k=std::max(j - FIT_BAND, 0); k<i; k++) {
+				s -= mat[k * FIT_STRIDE + i - k] * mat[k * FIT_STRIDE + j - k];
+			}
+			mat[i * FIT_STRIDE + j - i] = s / diag;
+		}
+	}
+	return true;
+}
+
+// solve U^T U x = b with the factorization, b (3 per row) is replaced by x
+static void band_solve(const double *mat, int n, double *b)
+{
+	for(int i=0; i<n; i++) {
+		for(int k=std::max(i - FIT_BAND, 0); k<i; k++) {
+			double u = mat[k * FIT_STRIDE + i - k];
+			for(int c=0; c<3; c++) {
+				b[i * 3 + c] -= u * b[k * 3 + c];
+			}
+		}
+		for(int c=0; c<3; c++) {
+			b[i * 3 + c] /= mat[i * FIT_STRIDE];
+		}
+	}
+	for(int i=n-1; i>=0; i--) {
+		int jend = std::min(i + FIT_BAND, n - 1);
+		for(int j=i+1; j<=jend; j++) {
+			double u = mat[i * FIT_STRIDE + j - i];
+			for(int c=0; c<3; c++) {
+				b[i * 3 + c] -= u * b[j * 3 + c];
+			}
+		}
+		for(int c=0; c<3; c++) {
+			b[i * 3 + c] /= mat[i * FIT_STRIDE];
+		}
+	}
+}
+
+// least squares control points for the points at parameters t
+static bool solve_fit(CurveType type, const Vector3 *pts, const float *t, int count,
+		int num_cp, std::vector<Vector4> *cp)
+{
+	std::vector<double> mat(num_cp * FIT_STRIDE, 0.0);
+	std::vector<double> rhs(num_cp * 3, 0.0);
+
+	for(int i=0; i<count; i++) {
+		int idx[4];
+		float w[4];
+		int n = basis(type, num_cp, t[i], idx, w);
+
+		for(int j=0; j<n; j++) {
+			double *row = &mat[idx[j] * FIT_STRIDE];
+			for(int k=j; k<n; k++) {
+				row[idx[k] - idx[j]] += (double)w[j] * (double)w[k];
+			}
+			double *r = &rhs[idx[j] * 3];
+			r[0] += (double)w[j] * pts[i].x;
+			r[1] += (double)w[j] * pts[i].y;
+			r[2] += (double)w[j] * pts[i].z;
+		}
+	}
+
+	double lambda = FIT_SMOOTHING * (double)count / (double)num_cp;
+	static const double d[3] = {1.0, -2.0, 1.0};
+	for(int i=1; i<num_cp - 1; i++) {
+		for(int j=0; j<3; j++) {
+			for(int k=j; k<3; k++) {
+				mat[(i - 1 + j) * FIT_STRIDE + k - j] += lambda * d[j] * d[k];
+			}
+		}
+	}
+
+	if(!band_cholesky(&mat[0], num_cp)) {
+		return false;
+	}
+	band_solve(&mat[0], num_cp, &rhs[0]);
+
+	cp->resize(num_cp);
+	for(int i=0; i<num_cp; i++) {
+		(*cp)[i] = Vector4(rhs[i * 3], rhs[i * 3 + 1], rhs[i * 3 + 2], 1.0);
+	}
+	return true;
+}
+
+// parameters proportional to the distance along the polyline of the points
+static void chord_params(const Vector3 *pts, int count, float *t)
+{
+	double len = 0.0;
+	t[0] = 0.0f;
+	for(int i=1; i<count; i++) {
+		len += (pts[i] - pts[i - 1]).length();
+		t[i] = (float)len;
+	}
+
+	if(len <= 0.0) {
+		for(int i=0; i<count; i++) {
+			t[i] = (float)i / (float)(count - 1);
+		}
+		return;
+	}
+
+	double s = 1.0 / len;
+	for(int i=1; i<count; i++) {
+		t[i] = (float)(t[i] * s);
+	}
+	t[count - 1] = 1.0f;
+}
+
+// move each parameter towards the projection of its point (one newton step)
+static void reparam(const Curve &curve, const Vector3 *pts, int count, float *t)
+{
+	for(int i=0; i<count; i++) {
+		Vector3 dp = curve.interpolate(t[i]) - pts[i];
+		Vector3 d = curve.deriv(t[i]);
+		Vector3 dd = curve.deriv2(t[i]);
+
+		float denom = dot_product(d, d) + dot_product(dp, dd);
+		if(denom > 0.0f) {
+			float nt = t[i] - dot_product(dp, d) / denom;
+			t[i] = std::max(0.0f, std::min(nt, 1.0f));
+		}
+	}
+}
+
+static void fit_error(CurveType type, const std::vector<Vector4> &cp, const Vector3 *pts,
+		const float *t, int count, CurveFitStats *stats)
+{
+	double sum = 0.0;
+	float max_dsq = 0.0f;
+	for(int i=0; i<count; i++) {
+		float dsq = (eval_basis(type, cp, t[i]) - pts[i]).length_sq();
+		max_dsq = std::max(max_dsq, dsq);
+		sum += dsq;
+	}
+	stats->num_cp = (int)cp.size();
+	stats->max_err = sqrt(max_dsq);
+	stats->rms_err = (float)sqrt(sum / (double)count);
+}
+
+static bool fit(Curve *curve, CurveType type, const Vector3 *pts, int count, int num_cp,
+		float *t, CurveFitStats *stats)
+{
+	std::vector<Vector4> cp;
+
+	chord_params(pts, count, t);
+	if(!solve_fit(type, pts, t, count, num_cp, &cp)) {
+		return false;
+	}
+
+	for(int i=0; i<FIT_REPARAM_ITER; i++) {
+		curve->clear();
+		curve->set_type(type);
+		for(int j=0; j<num_cp; j++) {
+			curve->add_point(cp[j]);
+		}
+		reparam(*curve, pts, count, t);
+
+		if(!solve_fit(type, pts, t, count, num_cp, &cp)) {
+			return false;
+		}
+	}
+
+	curve->clear();
+	curve->set_type(type);
+	for(int i=0; i<num_cp; i++) {
+		curve->add_point(cp[i]);
+	}
+	fit_error(type, cp, pts, t, count, stats);
+	++stats->num_fits;
+	return true;
+}
+
+bool fit_curve_cp(Curve *curve, CurveType type, const Vector3 *pts, int count, int num_cp,
+		CurveFitStats *stats)
+{
+	CurveFitStats tmp;
+	if(!stats) stats = &tmp;
+	stats->num_fits = 0;
+
+	if(count < 2 || num_cp < 2) {
+		return false;
+	}
+
+	std::vector<float> t(count);
+	return fit(curve, type, pts, count, num_cp, &t[0], stats);
+}
+
+bool fit_curve(Curve *curve, CurveType type, const Vector3 *pts, int count, float tol,
+		int max_cp, CurveFitStats *stats)
+{
+	CurveFitStats tmp;
+	if(!stats) stats = &tmp;
+	stats->num_fits = 0;
+
+	if(count < 2) {
+		return false;
+	}
+	int lim = max_cp > 0 ? std::min(max_cp, count) : count;
+	lim = std::max(lim, 2);
+
+	std::vector<float> t(count);
+	Curve best;
+	CurveFitStats best_stats;
+	int fail = 1, found = 0;
+
+	/* the error is roughly decreasing with the number of control points:
+	 * double the count until the fit is within tol, then bisect.
+	 */
+	int num_cp = std::min(FIT_START_CP, lim);
+	for(;;) {
+		if(fit(curve, type, pts, count, num_cp, &t[0], stats) && stats->max_err <= tol) {
+			found = num_cp;
+			best = *curve;
+			best_stats = *stats;
+			break;
+		}
+		fail = num_cp;
+		if(num_cp >= lim) {
+			return false;
+		}
+		num_cp = std::min(num_cp * 2, lim);
+	}
+
+	while(found - fail > 1) {
+		num_cp = (fail + found) / 2;
+		if(fit(curve, type, pts, count, num_cp, &t[0], stats) && stats->max_err <= tol) {
+			found = num_cp;
+			best = *curve;
+			best_stats = *stats;
+		} else {
+			fail = num_cp;
+		}
+	}
+
+	best_stats.num_fits = stats->num_fits;
+	*curve = best;
+	*stats = best_stats;
+	return true;
+}
+
+bool fit_curve(Curve *curve, CurveType type, const Vector2 *pts, int count, float tol,
+		int max_cp, CurveFitStats *stats)
+{
+	std::vector<Vector3> pts3(count);
+	for(int i=0; i<count; i++) {
+		pts3[i] = Vector3(pts[i].x, pts[i].y, 0.0f);
+	}
+	return fit_curve(curve, type, pts3.empty() ? 0 : &pts3[0], count, tol, max_cp, stats);
+}
@@ -0,0 +1,53 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CURVEFIT_H_
+#define CURVEFIT_H_
+
+#include "curve.h"
+
+// how well a fitted curve matches its input points (see fit_curve)
+struct CurveFitStats {
+	int num_cp;		// control points of the fitted curve
+	float max_err;	// largest distance of an input point from its point on the curve
+	float rms_err;	// root mean square of the same distances
+	int num_fits;	// least squares fits tried
+};
+
+/* fit_curve replaces the control points of curve with the fewest control
+ * points of type for which every input point is within tol of the curve,
+ * by least squares. The points are assigned parameter values by chord
+ * length, refined by projection on the fitted curve.
+ *
+ * The normal equations are banded, and assembled from the input in one pass
+ * per fit, so the memory used besides the input is a float per point plus
+ * a few values per control point, and inputs of millions of points take a
+ * fraction of a second per fit.
+ *
+ * Returns false if no curve with up to count control points (or max_cp if
+ * not 0) is within tol, leaving the closest fit in curve.
+ */
+bool fit_curve(Curve *curve, CurveType type, const Vector3 *pts, int count, float tol,
+		int max_cp = 0, CurveFitStats *stats = 0);
+bool fit_curve(Curve *curve, CurveType type, const Vector2 *pts, int count, float tol,
+		int max_cp = 0, CurveFitStats *stats = 0);
+
+// least squares fit with a fixed number of control points (at least 2)
+bool fit_curve_cp(Curve *curve, CurveType type, const Vector3 *pts, int count, int num_cp,
+		CurveFitStats *stats = 0);
+
+#endif	// CURVEFIT_H_
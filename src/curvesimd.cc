@@ -0,0 +1,284 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* batch evaluation of curves at many parameter values, with SSE2/AVX2 code
+ * paths where available, and a scalar fallback.
+ */
+#include <math.h>
+#include <algorithm>
+#include "curve.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2
+#include <emmintrin.h>
+#endif
+
+/* the AVX2 path is compiled with a target attribute and selected at runtime,
+ * so that the same binary still runs on processors without AVX2.
+ */
+#if defined(USE_SSE2) && defined(__GNUC__) && !defined(__clang__) && \
+	(__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define USE_AVX2
+#elif defined(USE_SSE2) && defined(__clang__) && __clang_major__ >= 4
+#define USE_AVX2
+#endif
+
+#ifdef USE_AVX2
+#include <immintrin.h>
+#define AVX2_FUNC	__attribute__((target("avx2")))
+#endif
+
+// parameters shared by all code paths
+struct BatchParam {
+	const float *coef;	// 16 floats per segment (4 homogeneous coefficients)
+	int num_cp;
+	bool rational;
+};
+
+static void batch_scalar(const BatchParam &bp, const float *tarr, int count,
+		float *xout, float *yout, float *zout)
+{
+	int last = bp.num_cp - 2;
+	float dt = 1.0 / (float)(bp.num_cp - 1);
+
+	for(int i=0; i<count; i++) {
+		float t = tarr[i];
+		if(t < 0.0) t = 0.0;
+		if(t > 1.0) t = 1.0;
+
+		int idx0 = std::min((int)floor(t * (bp.num_cp - 1)), last);
+		float t0 = (float)idx0 * dt;
+		float t1 = (float)(idx0 + 1) * dt;
+
+		t = (t - t0) / (t1 - t0);
+		if(t < 0.0) t = 0.0;
+		if(t > 1.0) t = 1.0;
+
+		const float *c = bp.coef + idx0 * 16;
+		float res[4];
+		for(int j=0; j<4; j++) {
+			res[j] = ((c[12 + j] * t + c[8 + j]) * t + c[4 + j]) * t + c[j];
+		}
+		if(bp.rational && res[3] != 0.0f) {
+			float s = 1.0f / res[3];
+			res[0] *= s;
+			res[1] *= s;
+			res[2] *= s;
+		}
+
+		xout[i] = res[0];
+		yout[i] = res[1];
+		if(zout) zout[i] = res[2];
+	}
+}
+
+#ifdef USE_SSE2
+static int batch_sse2(const BatchParam &bp, const float *tarr, int count,
+		float *xout, float *yout, float *zout)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 nseg = _mm_set1_ps((float)(bp.num_cp - 1));
+	const __m128 last = _mm_set1_ps((float)(bp.num_cp - 2));
+	const __m128 dt = _mm_set1_ps(1.0 / (float)(bp.num_cp - 1));
+
+	int i;
+	for(i=0; i<=count - 4; i+=4) {
+		__m128 t = _mm_loadu_ps(tarr + i);
+		t = _mm_min_ps(_mm_max_ps(t, zero), one);
+
+		// t is non-negative, so truncation is the same as floor
+		__m128 fidx = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(t, nseg)));
+		fidx = _mm_min_ps(fidx, last);
+
+		__m128 t0 = _mm_mul_ps(fidx, dt);
+		__m128 t1 = _mm_mul_ps(_mm_add_ps(fidx, one), dt);
+		t = _mm_div_ps(_mm_sub_ps(t, t0), _mm_sub_ps(t1, t0));
+		t = _mm_min_ps(_mm_max_ps(t, zero), one);
+
+		int idx[4];
+		_mm_storeu_si128((__m128i*)idx, _mm_cvttps_epi32(fidx));
+
+		const float *c0 = bp.coef + idx[0] * 16;
+		const float *c1 = bp.coef + idx[1] * 16;
+		const float *c2 = bp.coef + idx[2] * 16;
+		const float *c3 = bp.coef + idx[3] * 16;
+
+		// gather the coefficients of the 4 lanes, and transpose to SoA
+		__m128 x = _mm_loadu_ps(c0 + 12);
+		__m128 y = _mm_loadu_ps(c1 + 12);
+		__m128 z = _mm_loadu_ps(c2 + 12);
+		__m128 w = _mm_loadu_ps(c3 + 12);
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		for(int k=2; k>=0; k--) {
+			__m128 kx = _mm_loadu_ps(c0 + k * 4);
+			__m128 ky = _mm_loadu_ps(c1 + k * 4);
+			__m128 kz = _mm_loadu_ps(c2 + k * 4);
+			__m128 kw = _mm_loadu_ps(c3 + k * 4);
+			_MM_TRANSPOSE4_PS(kx, ky, kz, kw);
+
+			x = _mm_add_ps(_mm_mul_ps(x, t), kx);
+			y = _mm_add_ps(_mm_mul_ps(y, t), ky);
+			z = _mm_add_ps(_mm_mul_ps(z, t), kz);
+			w = _mm_add_ps(_mm_mul_ps(w, t), kw);
+		}
+
+		if(bp.rational) {
+			// divide by w, leaving lanes with w = 0 unchanged
+			__m128 nz = _mm_cmpneq_ps(w, zero);
+			__m128 s = _mm_div_ps(one, _mm_or_ps(_mm_and_ps(nz, w), _mm_andnot_ps(nz, one)));
+			x = _mm_mul_ps(x, s);
+			y = _mm_mul_ps(y, s);
+			z = _mm_mul_ps(z, s);
+		}
+
+		_mm_storeu_ps(xout + i, x);
+		_mm_storeu_ps(yout + i, y);
+		if(zout) _mm_storeu_ps(zout + i, z);
+	}
+	return i;
+}
+#endif	// USE_SSE2
+
+#ifdef USE_AVX2
+AVX2_FUNC static int batch_avx2(const BatchParam &bp, const float *tarr, int count,
+		float *xout, float *yout, float *zout)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 nseg = _mm256_set1_ps((float)(bp.num_cp - 1));
+	const __m256 last = _mm256_set1_ps((float)(bp.num_cp - 2));
+	const __m256 dt = _mm256_set1_ps(1.0 / (float)(bp.num_cp - 1));
+	const __m256i sixteen = _mm256_set1_epi32(16);
+
+	int i;
+	for(i=0; i<=count - 8; i+=8) {
+		__m256 t = _mm256_loadu_ps(tarr + i);
+		t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+
+		__m256 fidx = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(_mm256_mul_ps(t, nseg)));
+		fidx = _mm256_min_ps(fidx, last);
+
+		__m256 t0 = _mm256_mul_ps(fidx, dt);
+		__m256 t1 = _mm256_mul_ps(_mm256_add_ps(fidx, one), dt);
+		t = _mm256_div_ps(_mm256_sub_ps(t, t0), _mm256_sub_ps(t1, t0));
+		t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+
+		// float offset of the first coefficient of each lane's segment
+		__m256i offs = _mm256_mullo_epi32(_mm256_cvttps_epi32(fidx), sixteen);
+
+		__m256 x, y, z, w = one;
+		x = _mm256_i32gather_ps(bp.coef + 12, offs, 4);
+		y = _mm256_i32gather_ps(bp.coef + 13, offs, 4);
+		z = _mm256_i32gather_ps(bp.coef + 14, offs, 4);
+		if(bp.rational) {
+			w = _mm256_i32gather_ps(bp.coef + 15, offs, 4);
+		}
+		for(int k=2; k>=0; k--) {
+			const float *c = bp.coef + k * 4;
+			x = _mm256_add_ps(_mm256_mul_ps(x, t), _mm256_i32gather_ps(c, offs, 4));
+			y = _mm256_add_ps(_mm256_mul_ps(y, t), _mm256_i32gather_ps(c + 1, offs, 4));
+			z = _mm256_add_ps(_mm256_mul_ps(z, t), _mm256_i32gather_ps(c + 2, offs, 4));
+			if(bp.rational) {
+				w = _mm256_add_ps(_mm256_mul_ps(w, t), _mm256_i32gather_ps(c + 3, offs, 4));
+			}
+		}
+
+		if(bp.rational) {
+			__m256 nz = _mm256_cmp_ps(w, zero, _CMP_NEQ_UQ);
+			__m256 s = _mm256_div_ps(one, _mm256_blendv_ps(one, w, nz));
+			x = _mm256_mul_ps(x, s);
+			y = _mm256_mul_ps(y, s);
+			z = _mm256_mul_ps(z, s);
+		}
+
+		_mm256_storeu_ps(xout + i, x);
+		_mm256_storeu_ps(yout + i, y);
+		if(zout) _mm256_storeu_ps(zout + i, z);
+	}
+	return i;
+}
+
+static bool detect_avx2()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+static bool have_avx2()
+{
+	// initialization of local statics is thread-safe, and happens once
+	static const bool avx2 = detect_avx2();
+	return avx2;
+}
+#endif	// USE_AVX2
+
+void Curve::interpolate_batch(const float *t, int count, float *x, float *y, float *z) const
+{
+	if(count <= 0) return;
+
+	int num_cp = (int)cp.size();
+	if(num_cp <= 1) {
+		Vector3 v = interpolate(0.0f);
+		for(int i=0; i<count; i++) {
+			x[i] = v.x;
+			y[i] = v.y;
+			if(z) z[i] = v.z;
+		}
+		return;
+	}
+
+	BatchParam bp;
+	// Vector4 is 4 packed floats, access the coefficients as a float array
+	bp.coef = &get_coef(0)->x;
+	bp.num_cp = num_cp;
+	bp.rational = is_rational();
+
+	int done = 0;
+	switch(batch_mode.load(std::memory_order_relaxed)) {
+	case BATCH_AUTO:
+	case BATCH_AVX2:
+#ifdef USE_AVX2
+		if(have_avx2()) {
+			done = batch_avx2(bp, t, count, x, y, z);
+			break;
+		}
+#endif
+		// fallthrough
+	case BATCH_SSE2:
+#ifdef USE_SSE2
+		done = batch_sse2(bp, t, count, x, y, z);
+#endif
+		break;
+
+	default:
+		break;
+	}
+
+	// the remainder, or everything if there's no SIMD path
+	if(done < count) {
+		batch_scalar(bp, t + done, count - done, x + done, y + done, z ? z + done : 0);
+	}
+}
+
+std::atomic<BatchMode> Curve::batch_mode(BATCH_AUTO);
+
+BatchMode Curve::set_batch_mode(BatchMode mode)
+{
+	return batch_mode.exchange(mode);
+}
@@ -0,0 +1,219 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* control point reduction (Curve::simplify).
+ *
+ * The initial guess is the Douglas-Peucker simplification of the control
+ * polygon. Removing control points of a hermite or b-spline curve changes the
+ * curve around them in ways the control polygon doesn't show, so the result is
+ * then checked against the original curve, both ways, at a few points of every
+ * original segment. Each gap between kept control points which fails the check gets
+ * back its middle control point, and the check is repeated until all pass.
+ */
+#include <algorithm>
+#include <utility>
+#include "curve.h"
+
+#define SIMPLIFY_SAMPLES	4	// intervals checked per segment
+#define SIMPLIFY_MIN_SAMPLES	16	// min intervals checked per simplified segment
+
+// distance of p from the line segment a-b
+static float chord_dist_sq(const Vector3 &p, const Vector3 &a, const Vector3 &b)
+{
+	Vector3 ab = b - a;
+	float len_sq = ab.length_sq();
+	if(len_sq <= 0.0f) {
+		return (p - a).length_sq();
+	}
+	float t = dot_product(p - a, ab) / len_sq;
+	if(t < 0.0f) t = 0.0f;
+	if(t > 1.0f) t = 1.0f;
+	return (p - (a + ab * t)).length_sq();
+}
+
+// douglas-peucker on the control polygon, marks the control points to keep
+static void dp_mark(const Curve &curve, float tol_sq, std::vector<char> *keep)
+{
+	std::vector<std::pair<int, int> > stack;
+	stack.push_back(std::make_pair(0, curve.size() - 1));
+
+	while(!stack.empty()) {
+		int first = stack.back().first;
+		int last = stack.back().second;
+		stack.pop_back();
+
+		Vector3 a = curve.get_point3(first);
+		Vector3 b = curve.get_point3(last);
+
+		int max_idx = -1;
+		float max_dsq = tol_sq;
+		for(int i=first+1; i<last; i++) {
+			float dsq = chord_dist_sq(curve.get_point3(i), a, b);
+			if(dsq > max_dsq) {
+				max_dsq = dsq;
+				max_idx = i;
+			}
+		}
+
+		if(max_idx != -1) {
+			(*keep)[max_idx] = 1;
+			stack.push_back(std::make_pair(first, max_idx));
+			stack.push_back(std::make_pair(max_idx, last));
+		}
+	}
+}
+
+/* true if p is within tolerance of segments [first, last] of the curve. The
+ * point at segt of seg, where p is expected to be, is tried first, which
+ * avoids solving for the distance in most cases.
+ */
+static bool near_curve(const Curve &curve, int seg, float segt, int first, int last,
+		const Vector3 &p, float tol_sq)
+{
+	if((curve.interpolate_segment(seg, seg + 1, segt) - p).length_sq() <= tol_sq) {
+		return true;
+	}
+
+	first = std::max(first, 0);
+	last = std::min(last, curve.num_segments() - 1);
+	for(int i=first; i<=last; i++) {
+		if(curve.segment_dist_sq(i, p) <= tol_sq) {
+			return true;
+		}
+	}
+	return false;
+}
+
+float Curve::simplify(float tol)
+{
+	int num_cp = (int)cp.size();
+	if(num_cp <= 2 || tol <= 0.0f) {
+		return 0.0f;
+	}
+
+	const Curve orig = *this;
+	float tol_sq = tol * tol;
+
+	std::vector<char> keep(num_cp, 0);
+	keep[0] = keep[num_cp - 1] = 1;
+	dp_mark(orig, tol_sq, &keep);
+
+	std::vector<int> idx;		// indices of the kept control points
+	std::vector<int> gap(num_cp - 1);	// gap containing each original segment
+	std::vector<char> bad;
+
+	for(;;) {
+		idx.clear();
+		for(int i=0; i<num_cp; i++) {
+			if(keep[i]) idx.push_back(i);
+		}
+		int ngaps = (int)idx.size() - 1;
+
+		ChunkArray<Vector4>::const_iterator it = orig.cp.begin();
+		cp.clear();
+		for(int i=0, j=0; j<=ngaps; ++it, i++) {
+			if(i == idx[j]) {
+				cp.push_back(*it);
+				++j;
+			}
+		}
+		invalidate();
+
+		for(int i=0; i<ngaps; i++) {
+			for(int j=idx[i]; j<idx[i + 1]; j++) {
+				gap[j] = i;
+			}
+		}
+
+		bad.assign(ngaps, 0);
+		int nbad = 0;
+
+		// the original curve must be near the simplified one ...
+		for(int i=0; i<num_cp - 1; i++) {
+			int g = gap[i];
+			if(bad[g]) continue;
+
+			float width = (float)(idx[g + 1] - idx[g]);
+			for(int j=0; j<=SIMPLIFY_SAMPLES; j++) {
+				float t = (float)j / (float)SIMPLIFY_SAMPLES;
+				Vector3 p = orig.interpolate_segment(i, i + 1, t);
+				float segt = ((float)(i - idx[g]) + t) / width;
+
+				if(!near_curve(*this, g, segt, g - 1, g + 1, p, tol_sq)) {
+					bad[g] = 1;
+					++nbad;
+					break;
+				}
+			}
+		}
+
+		/* ... and the other way around, with as many samples in each gap as
+		 * the original segments it replaces got above, and more in short
+		 * gaps, where the curve can still bulge out between samples
+		 */
+		for(int i=0; i<ngaps; i++) {
+			if(bad[i]) continue;
+
+			int width = idx[i + 1] - idx[i];
+			int nsamples = std::max(width * SIMPLIFY_SAMPLES, SIMPLIFY_MIN_SAMPLES);
+			for(int j=0; j<=nsamples; j++) {
+				float t = (float)j / (float)nsamples;
+				Vector3 p = interpolate_segment(i, i + 1, t);
+				int seg = std::min(idx[i] + (int)(t * width), idx[i + 1] - 1);
+				float segt = t * width - (float)(seg - idx[i]);
+
+				if(!near_curve(orig, seg, segt, idx[i] - 1, idx[i + 1], p, tol_sq)) {
+					bad[i] = 1;
+					++nbad;
+					break;
+				}
+			}
+		}
+
+		if(!nbad) break;
+
+		/* restore the middle control point of each failed gap. Gaps without
+		 * removed points can only fail because of their neighbours, which
+		 * determine the tangents (hermite) or the shape (b-spline) at the ends.
+		 */
+		int added = 0;
+		for(int i=0; i<ngaps; i++) {
+			if(!bad[i]) continue;
+
+			for(int j=-1; j<=1; j++) {
+				int g = i + j;
+				if(g < 0 || g >= ngaps || (j != 0 && idx[i + 1] - idx[i] > 1)) {
+					continue;
+				}
+				int mid = (idx[g] + idx[g + 1]) / 2;
+				if(!keep[mid]) {
+					keep[mid] = 1;
+					++added;
+				}
+			}
+		}
+
+		if(!added) {
+			// shouldn't happen, since the original curve always passes
+			cp = orig.cp;
+			invalidate();
+			return 0.0f;
+		}
+	}
+
+	return 1.0f - (float)cp.size() / (float)num_cp;
+}
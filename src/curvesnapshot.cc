@@ -0,0 +1,233 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "curvesnapshot.h"
+
+/* the control points are shared with the source curve, and only copied
+ * chunk by chunk as either of them is modified (see chunkarray.h). So are
+ * the tables of the source curve which are valid, which the curve replaces
+ * instead of modifying, prepare calculates the rest, and the tessellation
+ * cache is never copied since the snapshot doesn't use it. The source curve must not be modified by another thread
+ * while the snapshot is being taken.
+ */
+CurveSnapshot::CurveSnapshot(const Curve &curve)
+	: curve(curve.type)
+{
+	Curve *c = &this->curve;
+	c->cp = curve.cp;
+	c->version = curve.version;
+
+	if((c->bbvalid = curve.bbvalid)) {
+		c->bbmin = curve.bbmin;
+		c->bbmax = curve.bbmax;
+	}
+	if((c->coefvalid = curve.coefvalid)) {
+		c->coef = curve.coef;
+		c->coefrational = curve.coefrational;
+	}
+	if((c->arclenvalid = curve.arclenvalid)) {
+		c->arclen = curve.arclen;
+	}
+	if((c->segbbvalid = curve.segbbvalid)) {
+		c->cbbmin = curve.cbbmin;
+		c->cbbmax = curve.cbbmax;
+		c->segbb = curve.segbb;
+	}
+
+	src_version = curve.version;
+	c->prepare();
+}
+
+unsigned int CurveSnapshot::get_version() const
+{
+	return src_version;
+}
+
+bool CurveSnapshot::is_current(const Curve &curve) const
+{
+	return curve.get_version() == src_version;
+}
+
+CurveType CurveSnapshot::get_type() const
+{
+	return curve.get_type();
+}
+
+bool CurveSnapshot::empty() const
+{
+	return curve.empty();
+}
+
+int CurveSnapshot::size() const
+{
+	return curve.size();
+}
+
+int CurveSnapshot::num_segments() const
+{
+	return curve.num_segments();
+}
+
+const Vector4 &CurveSnapshot::operator [](int idx) const
+{
+	return curve[idx];
+}
+
+const Vector4 &CurveSnapshot::get_point(int idx) const
+{
+	return curve.get_point(idx);
+}
+
+Vector3 CurveSnapshot::get_point3(int idx) const
+{
+	return curve.get_point3(idx);
+}
+
+Vector2 CurveSnapshot::get_point2(int idx) const
+{
+	return curve.get_point2(idx);
+}
+
+float CurveSnapshot::get_weight(int idx) const
+{
+	return curve.get_weight(idx);
+}
+
+int CurveSnapshot::nearest_point(const Vector3 &p) const
+{
+	return curve.nearest_point(p);
+}
+
+int CurveSnapshot::nearest_point(const Vector2 &p) const
+{
+	return curve.nearest_point(p);
+}
+
+void CurveSnapshot::get_bbox(Vector3 *bbmin, Vector3 *bbmax) const
+{
+	curve.get_bbox(bbmin, bbmax);
+}
+
+void CurveSnapshot::get_curve_bbox(Vector3 *bbmin, Vector3 *bbmax) const
+{
+	curve.get_curve_bbox(bbmin, bbmax);
+}
+
+void CurveSnapshot::get_segment_bbox(int seg, Vector3 *bbmin, Vector3 *bbmax) const
+{
+	curve.get_segment_bbox(seg, bbmin, bbmax);
+}
+
+float CurveSnapshot::proj_param(const Vector3 &p) const
+{
+	return curve.proj_param(p);
+}
+
+Vector3 CurveSnapshot::proj_point(const Vector3 &p) const
+{
+	return curve.proj_point(p);
+}
+
+float CurveSnapshot::distance(const Vector3 &p) const
+{
+	return curve.distance(p);
+}
+
+float CurveSnapshot::distance_sq(const Vector3 &p) const
+{
+	return curve.distance_sq(p);
+}
+
+Vector3 CurveSnapshot::interpolate_segment(int a, int b, float t) const
+{
+	return curve.interpolate_segment(a, b, t);
+}
+
+Vector3 CurveSnapshot::interpolate(float t) const
+{
+	return curve.interpolate(t);
+}
+
+Vector2 CurveSnapshot::interpolate2(float t) const
+{
+	return curve.interpolate2(t);
+}
+
+Vector3 CurveSnapshot::operator ()(float t) const
+{
+	return curve(t);
+}
+
+Vector3 CurveSnapshot::deriv(float t) const
+{
+	return curve.deriv(t);
+}
+
+Vector3 CurveSnapshot::deriv2(float t) const
+{
+	return curve.deriv2(t);
+}
+
+CurveFrame CurveSnapshot::eval_frame(float t) const
+{
+	return curve.eval_frame(t);
+}
+
+void CurveSnapshot::eval_frames(int samples, CurveFrame *out) const
+{
+	curve.eval_frames(samples, out);
+}
+
+float CurveSnapshot::length() const
+{
+	return curve.length();
+}
+
+float CurveSnapshot::param_at_length(float s) const
+{
+	return curve.param_at_length(s);
+}
+
+Vector3 CurveSnapshot::interpolate_by_length(float s) const
+{
+	return curve.interpolate_by_length(s);
+}
+
+void CurveSnapshot::tessellate(int samples, Vector3 *out) const
+{
+	curve.tessellate(samples, out);
+}
+
+void CurveSnapshot::tessellate2(int samples, Vector2 *out) const
+{
+	curve.tessellate2(samples, out);
+}
+
+void CurveSnapshot::tessellate_range(int samples, int first, int count, Vector3 *out) const
+{
+	curve.tessellate_range(samples, first, count, out);
+}
+
+void CurveSnapshot::interpolate_batch(const float *t, int count, float *x, float *y, float *z) const
+{
+	curve.interpolate_batch(t, count, x, y, z);
+}
+
+int CurveSnapshot::tessellate_adaptive(float tol, std::vector<Vector3> *out) const
+{
+	return curve.tessellate_adaptive(tol, out);
+}
@@ -0,0 +1,87 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CURVESNAPSHOT_H_
+#define CURVESNAPSHOT_H_
+
+#include "curve.h"
+
+/* CurveSnapshot is a frozen copy of a curve, with all its lazily evaluated
+ * data calculated when it's created. It only provides read-only access, and
+ * nothing in it changes after construction, so a snapshot can be shared by
+ * any number of threads without locking, while the original curve goes on
+ * being edited.
+ */
+class CurveSnapshot {
+private:
+	Curve curve;
+	unsigned int src_version;
+
+public:
+	explicit CurveSnapshot(const Curve &curve);
+
+	// version of the source curve at the time the snapshot was taken
+	unsigned int get_version() const;
+	// true if the curve has not been modified since the snapshot was taken
+	bool is_current(const Curve &curve) const;
+
+	CurveType get_type() const;
+	bool empty() const;
+	int size() const;
+	int num_segments() const;
+
+	const Vector4 &operator [](int idx) const;
+	const Vector4 &get_point(int idx) const;
+	Vector3 get_point3(int idx) const;
+	Vector2 get_point2(int idx) const;
+	float get_weight(int idx) const;
+
+	int nearest_point(const Vector3 &p) const;
+	int nearest_point(const Vector2 &p) const;
+
+	void get_bbox(Vector3 *bbmin, Vector3 *bbmax) const;
+	void get_curve_bbox(Vector3 *bbmin, Vector3 *bbmax) const;
+	void get_segment_bbox(int seg, Vector3 *bbmin, Vector3 *bbmax) const;
+
+	float proj_param(const Vector3 &p) const;
+	Vector3 proj_point(const Vector3 &p) const;
+	float distance(const Vector3 &p) const;
+	float distance_sq(const Vector3 &p) const;
+
+	Vector3 interpolate_segment(int a, int b, float t) const;
+	Vector3 interpolate(float t) const;
+	Vector2 interpolate2(float t) const;
+	Vector3 operator ()(float t) const;
+
+	Vector3 deriv(float t) const;
+	Vector3 deriv2(float t) const;
+	CurveFrame eval_frame(float t) const;
+	void eval_frames(int samples, CurveFrame *out) const;
+
+	float length() const;
+	float param_at_length(float s) const;
+	Vector3 interpolate_by_length(float s) const;
+
+	void tessellate(int samples, Vector3 *out) const;
+	void tessellate2(int samples, Vector2 *out) const;
+	void tessellate_range(int samples, int first, int count, Vector3 *out) const;
+	void interpolate_batch(const float *t, int count, float *x, float *y, float *z) const;
+	// there's no cached tessellation, each call produces a new one
+	int tessellate_adaptive(float tol, std::vector<Vector3> *out) const;
+};
+
+#endif	// CURVESNAPSHOT_H_
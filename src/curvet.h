@@ -0,0 +1,321 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CURVET_H_
+#define CURVET_H_
+
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "curve.h"
+
+/* CurveT is a compact curve, storing only Dim coordinates per control point
+ * (plus the weight if Rational), in float or double precision. It evaluates
+ * the same curves as Curve: weights only affect b-splines, which are
+ * evaluated in homogeneous coordinates and divided by the interpolated
+ * weight. Non-rational curves skip the weight and the division altogether.
+ *
+ * A 2D float curve takes 8 bytes per point, instead of the 16 of a Curve.
+ * Use from_curve/to_curve to convert to and from Curve, which is still what
+ * the editor works with.
+ */
+template <typename Scalar, int Dim, bool Rational = false>
+class CurveT {
+	static_assert(Dim >= 1 && Dim <= 3, "CurveT supports 1 to 3 dimensions");
+
+public:
+	typedef Scalar scalar_type;
+	enum { STRIDE = Dim + (Rational ? 1 : 0) };
+
+	struct Point {
+		Scalar v[STRIDE];	// coordinates, followed by the weight if Rational
+	};
+
+private:
+	std::vector<Point> cp;
+	CurveType type;
+
+	static Point make_point(const Scalar *p, Scalar weight)
+	{
+		Point res;
+		for(int i=0; i<Dim; i++) {
+			res.v[i] = p[i];
+		}
+		if(Rational) {
+			res.v[Dim] = weight;
+		}
+		return res;
+	}
+
+	// polynomial coefficients of a segment, constant term first (see segment_coef in curve.cc)
+	void calc_coef(int seg, Scalar (*c)[STRIDE]) const
+	{
+		int num_cp = (int)cp.size();
+		const Scalar *prev = cp[seg > 0 ? seg - 1 : seg].v;
+		const Scalar *a = cp[seg].v;
+		const Scalar *b = cp[seg + 1].v;
+		const Scalar *next = cp[seg + 2 < num_cp ? seg + 2 : seg + 1].v;
+
+		for(int i=0; i<STRIDE; i++) {
+			if(type == CURVE_LINEAR || num_cp == 2) {
+				c[0][i] = a[i];
+				c[1][i] = b[i] - a[i];
+				c[2][i] = c[3][i] = 0;
+			} else if(type == CURVE_HERMITE) {
+				c[0][i] = a[i];
+				c[1][i] = (b[i] - prev[i]) * (Scalar)0.5;
+				c[2][i] = prev[i] - a[i] * (Scalar)2.5 + b[i] * (Scalar)2.0 - next[i] * (Scalar)0.5;
+				c[3][i] = (a[i] - b[i]) * (Scalar)1.5 + (next[i] - prev[i]) * (Scalar)0.5;
+			} else {
+				c[0][i] = (prev[i] + a[i] * (Scalar)4.0 + b[i]) * (Scalar)(1.0 / 6.0);
+				c[1][i] = (b[i] - prev[i]) * (Scalar)0.5;
+				c[2][i] = (prev[i] + b[i]) * (Scalar)0.5 - a[i];
+				c[3][i] = (a[i] - b[i]) * (Scalar)0.5 + (next[i] - prev[i]) * (Scalar)(1.0 / 6.0);
+			}
+		}
+	}
+
+	bool is_rational() const
+	{
+		return Rational && type == CURVE_BSPLINE && cp.size() > 2;
+	}
+
+	void eval_coef(const Scalar (*c)[STRIDE], Scalar t, bool rational, Scalar *res) const
+	{
+		Scalar h[STRIDE];
+		for(int i=0; i<STRIDE; i++) {
+			h[i] = ((c[3][i] * t + c[2][i]) * t + c[1][i]) * t + c[0][i];
+		}
+		Scalar s = 1;
+		if(rational && h[STRIDE - 1] != 0) {
+			s = 1 / h[STRIDE - 1];
+		}
+		for(int i=0; i<Dim; i++) {
+			res[i] = h[i] * s;
+		}
+	}
+
+	// same segment selection as Curve::find_segment
+	int find_segment(Scalar t, Scalar *segt) const
+	{
+		int num_cp = (int)cp.size();
+		if(t < 0) t = 0;
+		if(t > 1) t = 1;
+
+		int idx0 = std::min((int)floor(t * (num_cp - 1)), num_cp - 2);
+		Scalar dt = 1 / (Scalar)(num_cp - 1);
+		Scalar t0 = (Scalar)idx0 * dt;
+		Scalar t1 = (Scalar)(idx0 + 1) * dt;
+
+		t = (t - t0) / (t1 - t0);
+		if(t < 0) t = 0;
+		if(t > 1) t = 1;
+
+		*segt = t;
+		return idx0;
+	}
+
+public:
+	explicit CurveT(CurveType type = CURVE_HERMITE)
+	{
+		this->type = type;
+	}
+
+	void set_type(CurveType type)
+	{
+		this->type = type;
+	}
+
+	CurveType get_type() const
+	{
+		return type;
+	}
+
+	// p points to Dim coordinates, weight is ignored if not Rational
+	void add_point(const Scalar *p, Scalar weight = 1)
+	{
+		cp.push_back(make_point(p, weight));
+	}
+
+	bool set_point(int idx, const Scalar *p, Scalar weight = 1)
+	{
+		if(idx < 0 || idx >= (int)cp.size()) {
+			return false;
+		}
+		cp[idx] = make_point(p, weight);
+		return true;
+	}
+
+	void get_point(int idx, Scalar *p) const
+	{
+		for(int i=0; i<Dim; i++) {
+			p[i] = cp[idx].v[i];
+		}
+	}
+
+	Scalar get_weight(int idx) const
+	{
+		return Rational ? cp[idx].v[STRIDE - 1] : (Scalar)1;
+	}
+
+	void clear()
+	{
+		cp.clear();
+	}
+
+	bool empty() const
+	{
+		return cp.empty();
+	}
+
+	int size() const
+	{
+		return (int)cp.size();
+	}
+
+	void reserve(int num)
+	{
+		cp.reserve(num);
+	}
+
+	// bytes used by the control points
+	size_t mem_size() const
+	{
+		return cp.size() * sizeof(Point);
+	}
+
+	// bounds of the control points, Dim values each
+	void calc_bbox(Scalar *bmin, Scalar *bmax) const
+	{
+		for(int i=0; i<Dim; i++) {
+			bmin[i] = bmax[i] = cp.empty() ? 0 : cp[0].v[i];
+		}
+		for(size_t j=1; j<cp.size(); j++) {
+			for(int i=0; i<Dim; i++) {
+				bmin[i] = std::min(bmin[i], cp[j].v[i]);
+				bmax[i] = std::max(bmax[i], cp[j].v[i]);
+			}
+		}
+	}
+
+	// evaluate the curve at t in [0, 1], writing Dim values to res
+	void interpolate(Scalar t, Scalar *res) const
+	{
+		int num_cp = (int)cp.size();
+		if(num_cp <= 1) {
+			for(int i=0; i<Dim; i++) {
+				res[i] = num_cp ? cp[0].v[i] : 0;
+			}
+			return;
+		}
+
+		Scalar segt;
+		int seg = find_segment(t, &segt);
+
+		Scalar c[4][STRIDE];
+		calc_coef(seg, c);
+		eval_coef(c, segt, is_rational(), res);
+	}
+
+	/* evaluate samples points uniformly spaced in t (like Curve::tessellate),
+	 * writing samples * Dim values to out. The coefficients are calculated
+	 * once per segment.
+	 */
+	void tessellate(int samples, Scalar *out) const
+	{
+		int num_cp = (int)cp.size();
+		if(samples <= 0) return;
+		if(num_cp <= 1 || samples == 1) {
+			for(int i=0; i<samples; i++) {
+				interpolate(0, out + i * Dim);
+			}
+			return;
+		}
+
+		bool rational = is_rational();
+		Scalar c[4][STRIDE];
+		int cur_seg = -1;
+
+		for(int i=0; i<samples; i++) {
+			Scalar segt;
+			int seg = find_segment((Scalar)i / (Scalar)(samples - 1), &segt);
+			if(seg != cur_seg) {
+				calc_coef(seg, c);
+				cur_seg = seg;
+			}
+			eval_coef(c, segt, rational, out + i * Dim);
+		}
+	}
+
+	/* replace the contents with the control points of a Curve. Fails without
+	 * changing anything if the curve is a b-spline with weights other than 1
+	 * and this CurveT isn't Rational, since dropping them would change the
+	 * shape. The weights of other curve types don't affect them.
+	 */
+	bool from_curve(const Curve &curve)
+	{
+		int num = curve.size();
+		if(!Rational && curve.get_type() == CURVE_BSPLINE && num > 2) {
+			for(int i=0; i<num; i++) {
+				if(curve.get_weight(i) != 1.0f) {
+					return false;
+				}
+			}
+		}
+
+		type = curve.get_type();
+		cp.resize(num);
+		for(int i=0; i<num; i++) {
+			const Vector4 &v = curve.get_point(i);
+			for(int j=0; j<Dim; j++) {
+				cp[i].v[j] = (Scalar)v[j];
+			}
+			if(Rational) {
+				cp[i].v[Dim] = (Scalar)v.w;
+			}
+		}
+		return true;
+	}
+
+	// write the control points to a Curve (missing coordinates are 0, weights 1)
+	void to_curve(Curve *curve) const
+	{
+		curve->clear();
+		curve->set_type(type);
+		for(size_t i=0; i<cp.size(); i++) {
+			Vector4 v = Vector4(0, 0, 0, 1);
+			for(int j=0; j<Dim; j++) {
+				v[j] = (float)cp[i].v[j];
+			}
+			if(Rational) {
+				v.w = (float)cp[i].v[Dim];
+			}
+			curve->add_point(v);
+		}
+	}
+};
+
+typedef CurveT<float, 2> Curve2f;
+typedef CurveT<double, 2> Curve2d;
+typedef CurveT<float, 3> Curve3f;
+typedef CurveT<double, 3> Curve3d;
+typedef CurveT<float, 2, true> RationalCurve2f;
+typedef CurveT<double, 2, true> RationalCurve2d;
+typedef CurveT<float, 3, true> RationalCurve3f;
+typedef CurveT<double, 3, true> RationalCurve3d;
+
+#endif	// CURVET_H_
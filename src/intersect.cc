@@ -0,0 +1,405 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include <algorithm>
+#include <map>
+#include "intersect.h"
+
+#define ISECT_MAX_DEPTH		24
+#define ISECT_NEWTON_ITER	12
+/* a cubic segment can cross itself once, so for self intersections each
+ * segment is split in a few pieces, which are intersected with each other
+ * like the segments of two different curves.
+ */
+#define SELF_SPLIT	4
+
+// a part of a curve, in bezier form, with its range of curve parameters
+struct Piece {
+	Bezier bez;
+	float t0, t1;
+	Vector3 bmin, bmax;
+};
+
+struct IsectContext {
+	const Curve *ca, *cb;
+	bool self;
+	float tol;
+	std::vector<CurveIsect> hits;
+};
+
+static void make_pieces(const Curve *curve, int split, std::vector<Piece> *pieces)
+{
+	int nseg = curve->num_segments();
+	pieces->clear();
+
+	for(int i=0; i<nseg; i++) {
+		Bezier rest = curve->get_bezier(i);
+
+		for(int j=0; j<split; j++) {
+			Piece p;
+			if(j < split - 1) {
+				bezier_split(rest, 1.0f / (float)(split - j), &p.bez, &rest);
+			} else {
+				p.bez = rest;
+			}
+			p.t0 = ((float)i + (float)j / (float)split) / (float)nseg;
+			p.t1 = ((float)i + (float)(j + 1) / (float)split) / (float)nseg;
+
+			if(split == 1) {
+				curve->get_segment_bbox(i, &p.bmin, &p.bmax);
+			} else {
+				bezier_hull_bbox(p.bez, &p.bmin, &p.bmax);
+			}
+			pieces->push_back(p);
+		}
+	}
+	if(!pieces->empty()) {
+		pieces->back().t1 = 1.0f;
+	}
+}
+
+static inline bool overlap_xy(const Vector3 &amin, const Vector3 &amax,
+		const Vector3 &bmin, const Vector3 &bmax, float margin)
+{
+	return amin.x <= bmax.x + margin && bmin.x <= amax.x + margin &&
+		amin.y <= bmax.y + margin && bmin.y <= amax.y + margin;
+}
+
+struct SweepItem {
+	float x;
+	int side, idx;
+
+	bool operator <(const SweepItem &it) const { return x < it.x; }
+};
+
+/* pairs of pieces (one from each list) with overlapping bounds, by sweeping
+ * along x. With self, pb is ignored and the pairs are (i, j) with i < j of pa.
+ */
+static void find_pairs(const std::vector<Piece> &pa, const std::vector<Piece> &pb, bool self,
+		float margin, std::vector<std::pair<int, int> > *pairs)
+{
+	std::vector<SweepItem> items;
+	for(size_t i=0; i<pa.size(); i++) {
+		SweepItem it = {pa[i].bmin.x, 0, (int)i};
+		items.push_back(it);
+	}
+	if(!self) {
+		for(size_t i=0; i<pb.size(); i++) {
+			SweepItem it = {pb[i].bmin.x, 1, (int)i};
+			items.push_back(it);
+		}
+	}
+	std::sort(items.begin(), items.end());
+
+	const std::vector<Piece> *plist[2] = {&pa, self ? &pa : &pb};
+	std::vector<int> active[2];
+
+	for(size_t i=0; i<items.size(); i++) {
+		int side = items[i].side;
+		int other = self ? side : 1 - side;
+		const Piece &p = (*plist[side])[items[i].idx];
+		std::vector<int> &act = active[other];
+
+		size_t j = 0;
+		while(j < act.size()) {
+			const Piece &q = (*plist[other])[act[j]];
+			if(q.bmax.x + margin < p.bmin.x) {
+				act[j] = act.back();
+				act.pop_back();
+				continue;
+			}
+			if(overlap_xy(p.bmin, p.bmax, q.bmin, q.bmax, margin)) {
+				if(self) {
+					pairs->push_back(std::make_pair(std::min(act[j], items[i].idx),
+								std::max(act[j], items[i].idx)));
+				} else if(side == 0) {
+					pairs->push_back(std::make_pair(items[i].idx, act[j]));
+				} else {
+					pairs->push_back(std::make_pair(act[j], items[i].idx));
+				}
+			}
+			++j;
+		}
+		active[side].push_back(items[i].idx);
+	}
+}
+
+// inner control points within tol of the chord (on the z = 0 plane)
+static bool is_flat(const Bezier &bez, float tol)
+{
+	Vector2 a = Vector2(bezier_point(bez, 0).x, bezier_point(bez, 0).y);
+	Vector2 b = Vector2(bezier_point(bez, 3).x, bezier_point(bez, 3).y);
+	Vector2 ab = b - a;
+	float len_sq = dot_product(ab, ab);
+
+	for(int i=1; i<3; i++) {
+		Vector3 p3 = bezier_point(bez, i);
+		Vector2 ap = Vector2(p3.x, p3.y) - a;
+		float dsq;
+		if(len_sq <= 0.0f) {
+			dsq = dot_product(ap, ap);
+		} else {
+			float cross = ab.x * ap.y - ab.y * ap.x;
+			dsq = cross * cross / len_sq;
+		}
+		if(dsq > tol * tol) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static inline float size_xy(const Vector3 &bmin, const Vector3 &bmax)
+{
+	return std::max(bmax.x - bmin.x, bmax.y - bmin.y);
+}
+
+// newton iteration from the intersection of the chords of the two parts
+static void refine(IsectContext *ctx, const Bezier &a, float a0, float a1,
+		const Bezier &b, float b0, float b1)
+{
+	Vector3 p0 = bezier_point(a, 0), p1 = bezier_point(a, 3);
+	Vector3 q0 = bezier_point(b, 0), q1 = bezier_point(b, 3);
+	Vector2 da = Vector2(p1.x - p0.x, p1.y - p0.y);
+	Vector2 db = Vector2(q1.x - q0.x, q1.y - q0.y);
+	Vector2 dq = Vector2(q0.x - p0.x, q0.y - p0.y);
+
+	float u = 0.5f, v = 0.5f;
+	float det = da.x * db.y - da.y * db.x;
+	if(fabs(det) > 1e-12f) {
+		u = std::max(0.0f, std::min((dq.x * db.y - dq.y * db.x) / det, 1.0f));
+		v = std::max(0.0f, std::min((dq.x * da.y - dq.y * da.x) / det, 1.0f));
+	}
+	float ta = a0 + (a1 - a0) * u;
+	float tb = b0 + (b1 - b0) * v;
+
+	float eps = ctx->tol * 1e-3f;
+	Vector3 pa, pb;
+	for(int i=0; i<ISECT_NEWTON_ITER; i++) {
+		pa = ctx->ca->interpolate(ta);
+		pb = ctx->cb->interpolate(tb);
+		float fx = pa.x - pb.x;
+		float fy = pa.y - pb.y;
+		if(fx * fx + fy * fy <= eps * eps) break;
+
+		// solve [Ca'(ta) -Cb'(tb)] [dta dtb] = -f
+		Vector3 dca = ctx->ca->deriv(ta);
+		Vector3 dcb = ctx->cb->deriv(tb);
+		float jdet = dcb.x * dca.y - dca.x * dcb.y;
+		if(fabs(jdet) < 1e-12f) break;
+
+		ta = std::max(0.0f, std::min(ta + (fx * dcb.y - dcb.x * fy) / jdet, 1.0f));
+		tb = std::max(0.0f, std::min(tb + (fx * dca.y - dca.x * fy) / jdet, 1.0f));
+	}
+	pa = ctx->ca->interpolate(ta);
+	pb = ctx->cb->interpolate(tb);
+
+	float dx = pa.x - pb.x;
+	float dy = pa.y - pb.y;
+	if(dx * dx + dy * dy > ctx->tol * ctx->tol) {
+		return;
+	}
+
+	// keep it local, anything farther is found from another pair of parts
+	float wa = a1 - a0, wb = b1 - b0;
+	if(ta < a0 - wa || ta > a1 + wa || tb < b0 - wb || tb > b1 + wb) {
+		return;
+	}
+
+	if(ctx->self) {
+		// points shared by consecutive parts are not intersections
+		int nseg = ctx->ca->num_segments();
+		if(fabs(ta - tb) * nseg < 1e-3f) {
+			return;
+		}
+		if(ta > tb) std::swap(ta, tb);
+	}
+
+	CurveIsect hit;
+	hit.a = ctx->ca;
+	hit.b = ctx->cb;
+	hit.ta = ta;
+	hit.tb = tb;
+	hit.pos = pa;
+	ctx->hits.push_back(hit);
+}
+
+static void subdivide(IsectContext *ctx, const Bezier &a, float a0, float a1,
+		const Bezier &b, float b0, float b1, int depth)
+{
+	Vector3 amin, amax, bmin, bmax;
+	bezier_hull_bbox(a, &amin, &amax);
+	bezier_hull_bbox(b, &bmin, &bmax);
+	if(!overlap_xy(amin, amax, bmin, bmax, ctx->tol)) {
+		return;
+	}
+
+	float flat_tol = ctx->tol * 0.5f;
+	bool flat_a = is_flat(a, flat_tol);
+	bool flat_b = is_flat(b, flat_tol);
+	if(depth >= ISECT_MAX_DEPTH || (flat_a && flat_b)) {
+		refine(ctx, a, a0, a1, b, b0, b1);
+		return;
+	}
+
+	if(!flat_a && (flat_b || size_xy(amin, amax) >= size_xy(bmin, bmax))) {
+		Bezier left, right;
+		bezier_split(a, 0.5f, &left, &right);
+		float amid = (a0 + a1) * 0.5f;
+		subdivide(ctx, left, a0, amid, b, b0, b1, depth + 1);
+		subdivide(ctx, right, amid, a1, b, b0, b1, depth + 1);
+	} else {
+		Bezier left, right;
+		bezier_split(b, 0.5f, &left, &right);
+		float bmid = (b0 + b1) * 0.5f;
+		subdivide(ctx, a, a0, a1, left, b0, bmid, depth + 1);
+		subdivide(ctx, a, a0, a1, right, bmid, b1, depth + 1);
+	}
+}
+
+static bool hit_less(const CurveIsect &a, const CurveIsect &b)
+{
+	return a.ta < b.ta;
+}
+
+// sort the hits and merge the ones closer than tol, appending them to res
+static int merge_hits(IsectContext *ctx, std::vector<CurveIsect> *res)
+{
+	std::vector<CurveIsect> &hits = ctx->hits;
+	std::sort(hits.begin(), hits.end(), hit_less);
+
+	size_t start = res->size();
+	float tol_sq = ctx->tol * ctx->tol;
+	for(size_t i=0; i<hits.size(); i++) {
+		bool dup = false;
+		for(size_t j=start; j<res->size(); j++) {
+			Vector3 d = hits[i].pos - (*res)[j].pos;
+			if(d.x * d.x + d.y * d.y <= tol_sq) {
+				dup = true;
+				break;
+			}
+		}
+		if(!dup) {
+			res->push_back(hits[i]);
+		}
+	}
+	return (int)(res->size() - start);
+}
+
+static int intersect(IsectContext *ctx, std::vector<CurveIsect> *res)
+{
+	std::vector<Piece> pa, pb;
+	make_pieces(ctx->ca, ctx->self ? SELF_SPLIT : 1, &pa);
+	if(!ctx->self) {
+		make_pieces(ctx->cb, 1, &pb);
+	}
+
+	std::vector<std::pair<int, int> > pairs;
+	find_pairs(pa, pb, ctx->self, ctx->tol, &pairs);
+
+	const std::vector<Piece> &plist = ctx->self ? pa : pb;
+	for(size_t i=0; i<pairs.size(); i++) {
+		const Piece &a = pa[pairs[i].first];
+		const Piece &b = plist[pairs[i].second];
+		subdivide(ctx, a.bez, a.t0, a.t1, b.bez, b.t0, b.t1, 0);
+	}
+	return merge_hits(ctx, res);
+}
+
+int intersect_curves(const Curve *a, const Curve *b, float tol, std::vector<CurveIsect> *res)
+{
+	if(a == b) {
+		return intersect_self(a, tol, res);
+	}
+	if(a->num_segments() <= 0 || b->num_segments() <= 0) {
+		return 0;
+	}
+
+	IsectContext ctx;
+	ctx.ca = a;
+	ctx.cb = b;
+	ctx.self = false;
+	ctx.tol = tol;
+	return intersect(&ctx, res);
+}
+
+int intersect_self(const Curve *curve, float tol, std::vector<CurveIsect> *res)
+{
+	if(curve->num_segments() <= 0) {
+		return 0;
+	}
+
+	IsectContext ctx;
+	ctx.ca = ctx.cb = curve;
+	ctx.self = true;
+	ctx.tol = tol;
+	return intersect(&ctx, res);
+}
+
+int intersect_line(const Curve *curve, const Vector3 &p0, const Vector3 &p1, float tol,
+		std::vector<CurveIsect> *res)
+{
+	Curve line(CURVE_LINEAR);
+	line.add_point(p0);
+	line.add_point(p1);
+
+	size_t start = res->size();
+	int count = intersect_curves(curve, &line, tol, res);
+	for(size_t i=start; i<res->size(); i++) {
+		(*res)[i].b = 0;
+	}
+	return count;
+}
+
+int intersect_scene(const CurveBVH *bvh, Curve * const *curves, int count, float tol,
+		bool self, std::vector<CurveIsect> *res)
+{
+	CurveBVH tmpbvh;
+	if(!bvh) {
+		tmpbvh.build(curves, count);
+		bvh = &tmpbvh;
+	}
+
+	std::map<const Curve*, int> index;
+	for(int i=0; i<count; i++) {
+		index[curves[i]] = i;
+	}
+
+	int num = 0;
+	std::vector<Curve*> cand;
+	for(int i=0; i<count; i++) {
+		if(self) {
+			num += intersect_self(curves[i], tol, res);
+		}
+
+		Vector3 bmin, bmax;
+		curves[i]->get_curve_bbox(&bmin, &bmax);
+		Vector3 margin = Vector3(tol, tol, tol);
+
+		cand.clear();
+		bvh->query(bmin - margin, bmax + margin, &cand);
+		for(size_t j=0; j<cand.size(); j++) {
+			std::map<const Curve*, int>::const_iterator it = index.find(cand[j]);
+			if(it == index.end() || it->second <= i) {
+				continue;
+			}
+			num += intersect_curves(curves[i], cand[j], tol, res);
+		}
+	}
+	return num;
+}
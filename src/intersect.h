@@ -0,0 +1,60 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef INTERSECT_H_
+#define INTERSECT_H_
+
+#include <vector>
+#include "curve.h"
+#include "bvh.h"
+
+/* intersection of two curves, or of a curve with itself (a == b, ta < tb),
+ * or with a line segment (b is null, tb is the parameter along the line).
+ * ta and tb are curve parameters, as in Curve::interpolate.
+ */
+struct CurveIsect {
+	const Curve *a, *b;
+	float ta, tb;
+	Vector3 pos;	// point on curve a
+};
+
+/* All intersection functions work on the z = 0 plane (z is ignored), and
+ * append the intersections found to res, in order of ta, returning how many.
+ *
+ * Candidate pairs of segments are found by sweeping their bounds, and each
+ * pair is subdivided in bezier form (de Casteljau) while their bounds
+ * overlap, until both parts are flat to within tol. The intersection of their
+ * chords is then refined by newton iteration on the curves, and accepted if
+ * they are closer than tol. Intersections closer than tol to each other are
+ * merged, and tangential contacts may be reported once or not at all.
+ * The curves' weights must be positive.
+ */
+int intersect_curves(const Curve *a, const Curve *b, float tol, std::vector<CurveIsect> *res);
+// self intersections, excluding the points shared by consecutive segments
+int intersect_self(const Curve *curve, float tol, std::vector<CurveIsect> *res);
+int intersect_line(const Curve *curve, const Vector3 &p0, const Vector3 &p1, float tol,
+		std::vector<CurveIsect> *res);
+
+/* all intersections between the curves, and of each curve with itself if
+ * self is true, grouped by pair of curves. The broad phase queries the bvh
+ * with the bounds of each curve (a temporary one is built if bvh is null).
+ * Curves in the bvh which are not in the curves array are ignored.
+ */
+int intersect_scene(const CurveBVH *bvh, Curve * const *curves, int count, float tol,
+		bool self, std::vector<CurveIsect> *res);
+
+#endif	// INTERSECT_H_
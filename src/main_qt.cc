@@ -4,8 +4,8 @@
 #include "app.h"
 
 struct Actions {
-	QAction *clear, *open, *save;
-	QAction *del;
+	QAction *clear, *open, *save, *export_bez, *bake;
+	QAction *del, *simplify;
 	QAction *quit;
 	QAction *snap_grid, *snap_pt;
 	QAction *polyline, *hermite, *bspline;
@@ -65,6 +65,14 @@ MainWindow::MainWindow()
 	act->save->setShortcut(QKeySequence::Save);
 	QObject::connect(act->save, &QAction::triggered, this, &MainWindow::save_curvefile);
 
+	act->export_bez = new QAction("&Export Bezier curves...", this);
+	act->export_bez->setStatusTip("Export the curves in piecewise cubic bezier form");
+	QObject::connect(act->export_bez, &QAction::triggered, this, &MainWindow::export_bezier);
+
+	act->bake = new QAction("&Bake curves...", this);
+	act->bake->setStatusTip("Export the curves as tables of samples for playback (hotkey: K)");
+	QObject::connect(act->bake, &QAction::triggered, this, &MainWindow::bake_curves);
+
 	act->quit = new QAction(style->standardIcon(QStyle::SP_DialogCloseButton), "&Quit", this);
 	act->quit->setShortcut(QKeySequence(tr("Ctrl+Q", "File|Quit")));
 	QObject::connect(act->quit, &QAction::triggered, this, &MainWindow::close);
@@ -73,6 +81,10 @@ MainWindow::MainWindow()
 	act->del->setStatusTip("Delete selected curve (hotkey: delete/backspace)");
 	QObject::connect(act->del, &QAction::triggered, this, &MainWindow::del_curve);
 
+	act->simplify = new QAction("Simplify curve", this);
+	act->simplify->setStatusTip("Remove control points of the selected curve, or all curves (hotkey: R)");
+	QObject::connect(act->simplify, &QAction::triggered, this, &MainWindow::simplify_curve);
+
 	act->snap_grid = new QAction(QIcon(":icon_snap_grid"), "Snap to grid", this);
 	act->snap_grid->setStatusTip("Snap to grid (hotkey: S)");
 	act->snap_grid->setCheckable(true);
@@ -119,11 +131,14 @@ MainWindow::MainWindow()
 	mfile->addAction(act->clear);
 	mfile->addAction(act->open);
 	mfile->addAction(act->save);
+	mfile->addAction(act->export_bez);
+	mfile->addAction(act->bake);
 	mfile->addSeparator();
 	mfile->addAction(act->quit);
 
 	QMenu *medit = menuBar()->addMenu("&Edit");
 	medit->addAction(act->del);
+	medit->addAction(act->simplify);
 	medit->addSeparator();
 	medit->addAction(act->polyline);
 	medit->addAction(act->hermite);
@@ -167,7 +182,7 @@ void MainWindow::clear_curves()
 
 void MainWindow::open_curvefile()
 {
-	QString fname = QFileDialog::getOpenFileName(this, "Open curve file", QString(), "Curves (*.curves)");
+	QString fname = QFileDialog::getOpenFileName(this, "Open curve file", QString(), "Curves (*.curves *.curvesb)");
 	if(!fname.isNull()) {
 		if(app_tool_load(qPrintable(fname))) {
 			glview->update();
@@ -179,9 +194,9 @@ void MainWindow::open_curvefile()
 
 void MainWindow::save_curvefile()
 {
-	QString fname = QFileDialog::getSaveFileName(this, "Save curve file", QString(), "Curves (*.curves)");
+	QString fname = QFileDialog::getSaveFileName(this, "Save curve file", QString(), "Curves (*.curves);;Binary curves (*.curvesb)");
 	if(!fname.isNull()) {
-		if(!fname.endsWith(".curves", Qt::CaseInsensitive)) {
+		if(!fname.endsWith(".curves", Qt::CaseInsensitive) && !fname.endsWith(".curvesb", Qt::CaseInsensitive)) {
 			fname += ".curves";
 		}
 		if(!app_tool_save(qPrintable(fname))) {
@@ -190,6 +205,32 @@ void MainWindow::save_curvefile()
 	}
 }
 
+void MainWindow::export_bezier()
+{
+	QString fname = QFileDialog::getSaveFileName(this, "Export bezier curves", QString(), "Bezier curves (*.bezier)");
+	if(!fname.isNull()) {
+		if(!fname.endsWith(".bezier", Qt::CaseInsensitive)) {
+			fname += ".bezier";
+		}
+		if(!app_tool_export_bezier(qPrintable(fname))) {
+			QMessageBox::critical(this, "Failed to export file!", "Failed to export file: " + fname);
+		}
+	}
+}
+
+void MainWindow::bake_curves()
+{
+	QString fname = QFileDialog::getSaveFileName(this, "Bake curves", QString(), "Baked curves (*.cbak)");
+	if(!fname.isNull()) {
+		if(!fname.endsWith(".cbak", Qt::CaseInsensitive)) {
+			fname += ".cbak";
+		}
+		if(!app_tool_bake(qPrintable(fname))) {
+			QMessageBox::critical(this, "Failed to export file!", "Failed to bake curves to: " + fname);
+		}
+	}
+}
+
 void MainWindow::open_bgimage()
 {
 	QString fname = QFileDialog::getOpenFileName(this, "Open background image", QString(), "Images (*.png *.jpg *.jpeg *.tga *.targa *.ppm *.rgbe)");
@@ -251,6 +292,12 @@ void MainWindow::del_curve()
 	app_tool_delete();
 }
 
+void MainWindow::simplify_curve()
+{
+	float ratio = app_tool_simplify();
+	statusBar()->showMessage(QString("Removed %1% of the control points").arg(ratio * 100.0f, 0, 'f', 1));
+}
+
 // ---- GLView implementation ----
 
 GLView::GLView()
@@ -15,11 +15,14 @@ private slots:
 	void clear_curves();
 	void open_curvefile();
 	void save_curvefile();
+	void export_bezier();
+	void bake_curves();
 	void open_bgimage();
 	void snap_grid();
 	void snap_pt();
 	void curve_type(int type);
 	void del_curve();
+	void simplify_curve();
 
 public:
 	Actions *act;
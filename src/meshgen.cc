@@ -0,0 +1,313 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* All meshes are a profile placed on a sequence of rings, each one an
+ * orthonormal frame: the profile x and y axes, and the sweep direction
+ * (x cross y). The ring frames are computed first, serially, which is cheap,
+ * and then the vertices of each chunk of rings are generated in parallel.
+ *
+ * With the sweep direction d, the surface tangents are d (along the sweep)
+ * and the profile tangent (tx, ty) in the ring frame, so the normal
+ * d x (tx X + ty Y) = tx Y - ty X is the left normal of the profile, mapped to
+ * the ring. For lathes and extrusions the frames only turn or move, and for
+ * sweeps with parallel transport frames the ring doesn't turn around d, so
+ * the mapped normal is exact in all cases.
+ */
+#include <math.h>
+#include <mutex>
+#include <algorithm>
+#include "meshgen.h"
+
+struct MeshRing {
+	Vector3 origin;
+	Vector3 xaxis, yaxis;
+};
+
+struct MeshGen {
+	const MeshGenOptions *opt;
+	int nprof, nrings;
+	int rings_per_chunk;
+
+	std::vector<Vector2> prof_pos;
+	std::vector<Vector2> prof_norm;	// left normals, or right if flipped
+	std::vector<float> prof_v;
+	std::vector<MeshRing> rings;
+
+	std::mutex out_lock;
+};
+
+MeshGenOptions::MeshGenOptions()
+{
+	profile_samples = 64;
+	rings = 64;
+	rings_per_chunk = 32;
+	flip = false;
+	pool = 0;
+	chunk_func = 0;
+	chunk_cls = 0;
+}
+
+static bool init_meshgen(MeshGen *mg, const Curve *profile, const MeshGenOptions &opt)
+{
+	if(opt.profile_samples < 2 || opt.rings < 2 || !opt.chunk_func || profile->size() < 2) {
+		return false;
+	}
+	mg->opt = &opt;
+	mg->nprof = opt.profile_samples;
+	mg->nrings = opt.rings;
+	mg->rings_per_chunk = std::max(opt.rings_per_chunk, 1);
+
+	std::vector<CurveFrame> frames(mg->nprof);
+	profile->eval_frames(mg->nprof, &frames[0]);
+
+	mg->prof_pos.resize(mg->nprof);
+	mg->prof_norm.resize(mg->nprof);
+	mg->prof_v.resize(mg->nprof);
+
+	float s = opt.flip ? -1.0f : 1.0f;
+	float dist = 0.0f;
+	for(int i=0; i<mg->nprof; i++) {
+		const CurveFrame &frm = frames[i];
+		mg->prof_pos[i] = Vector2(frm.pos.x, frm.pos.y);
+		mg->prof_norm[i] = Vector2(-frm.tangent.y * s, frm.tangent.x * s);
+		if(i > 0) {
+			dist += (mg->prof_pos[i] - mg->prof_pos[i - 1]).length();
+		}
+		mg->prof_v[i] = dist;
+	}
+	if(dist > 0.0f) {
+		for(int i=0; i<mg->nprof; i++) {
+			mg->prof_v[i] /= dist;
+		}
+	}
+
+	mg->rings.resize(mg->nrings);
+	return true;
+}
+
+static void gen_chunk(int idx, void *cls)
+{
+	MeshGen *mg = (MeshGen*)cls;
+	const MeshGenOptions *opt = mg->opt;
+	int nprof = mg->nprof;
+
+	int first_ring = idx * mg->rings_per_chunk;
+	int num_rings = std::min(mg->rings_per_chunk, mg->nrings - first_ring);
+
+	int nverts = num_rings * nprof;
+	std::vector<Vector3> verts(nverts);
+	std::vector<Vector3> normals(nverts);
+	std::vector<Vector2> uv(nverts);
+
+	int vidx = 0;
+	for(int i=0; i<num_rings; i++) {
+		int ring_idx = first_ring + i;
+		const MeshRing &ring = mg->rings[ring_idx];
+		float u = (float)ring_idx / (float)(mg->nrings - 1);
+
+		for(int j=0; j<nprof; j++) {
+			const Vector2 &p = mg->prof_pos[j];
+			const Vector2 &n = mg->prof_norm[j];
+			verts[vidx] = ring.origin + ring.xaxis * p.x + ring.yaxis * p.y;
+			normals[vidx] = ring.xaxis * n.x + ring.yaxis * n.y;
+			uv[vidx] = Vector2(u, mg->prof_v[j]);
+			++vidx;
+		}
+	}
+
+	// triangles from the previous ring to each ring of the chunk
+	int first_quad_ring = std::max(first_ring, 1);
+	std::vector<unsigned int> indices;
+	indices.reserve((first_ring + num_rings - first_quad_ring) * (nprof - 1) * 6);
+
+	for(int i=first_quad_ring; i<first_ring + num_rings; i++) {
+		unsigned int prev = (i - 1) * nprof;
+		unsigned int cur = i * nprof;
+
+		for(int j=0; j<nprof - 1; j++) {
+			unsigned int a = prev + j;
+			unsigned int b = cur + j;
+			unsigned int c = cur + j + 1;
+			unsigned int d = prev + j + 1;
+
+			// counter-clockwise: along the sweep, then along the profile
+			if(opt->flip) {
+				std::swap(b, d);
+			}
+			indices.push_back(a);
+			indices.push_back(b);
+			indices.push_back(c);
+			indices.push_back(a);
+			indices.push_back(c);
+			indices.push_back(d);
+		}
+	}
+
+	MeshChunk chunk;
+	chunk.first_ring = first_ring;
+	chunk.num_rings = num_rings;
+	chunk.first_vertex = first_ring * nprof;
+	chunk.num_verts = nverts;
+	chunk.verts = &verts[0];
+	chunk.normals = &normals[0];
+	chunk.uv = &uv[0];
+	chunk.first_index = (first_quad_ring - 1) * (nprof - 1) * 6;
+	chunk.num_indices = (int)indices.size();
+	chunk.indices = indices.empty() ? 0 : &indices[0];
+
+	std::lock_guard<std::mutex> lock(mg->out_lock);
+	opt->chunk_func(chunk, opt->chunk_cls);
+}
+
+static void run_meshgen(MeshGen *mg)
+{
+	ThreadPool *pool = mg->opt->pool;
+	int num_chunks = (mg->nrings + mg->rings_per_chunk - 1) / mg->rings_per_chunk;
+
+	if(pool && num_chunks > 1) {
+		pool->parallel_for(num_chunks, gen_chunk, mg);
+	} else {
+		for(int i=0; i<num_chunks; i++) {
+			gen_chunk(i, mg);
+		}
+	}
+}
+
+bool mesh_lathe(const Curve *profile, float angle, const MeshGenOptions &opt)
+{
+	MeshGen mg;
+	if(!init_meshgen(&mg, profile, opt)) {
+		return false;
+	}
+
+	for(int i=0; i<mg.nrings; i++) {
+		float theta = angle * (float)i / (float)(mg.nrings - 1);
+		MeshRing *ring = &mg.rings[i];
+		ring->origin = Vector3(0, 0, 0);
+		ring->xaxis = Vector3(cos(theta), 0, sin(theta));
+		ring->yaxis = Vector3(0, 1, 0);
+	}
+
+	// make a full turn close exactly
+	if(fabs(fabs(angle) - 2.0 * M_PI) < 1e-5) {
+		mg.rings[mg.nrings - 1] = mg.rings[0];
+	}
+
+	run_meshgen(&mg);
+	return true;
+}
+
+bool mesh_extrude(const Curve *profile, float depth, const MeshGenOptions &opt)
+{
+	MeshGen mg;
+	if(!init_meshgen(&mg, profile, opt)) {
+		return false;
+	}
+
+	for(int i=0; i<mg.nrings; i++) {
+		MeshRing *ring = &mg.rings[i];
+		ring->origin = Vector3(0, 0, depth * (float)i / (float)(mg.nrings - 1));
+		ring->xaxis = Vector3(1, 0, 0);
+		ring->yaxis = Vector3(0, 1, 0);
+	}
+
+	run_meshgen(&mg);
+	return true;
+}
+
+/* a vector perpendicular to the unit vector t, used when the path has no
+ * normal to start from (straight paths).
+ */
+static Vector3 any_perpendicular(const Vector3 &t)
+{
+	Vector3 v = fabs(t.z) < 0.9f ? Vector3(0, 0, 1) : Vector3(1, 0, 0);
+	return cross_product(t, v).normalized();
+}
+
+bool mesh_sweep(const Curve *profile, const Curve *path, const MeshGenOptions &opt)
+{
+	MeshGen mg;
+	if(path->size() < 2 || !init_meshgen(&mg, profile, opt)) {
+		return false;
+	}
+
+	std::vector<CurveFrame> frames(mg.nrings);
+	path->eval_frames(mg.nrings, &frames[0]);
+
+	Vector3 t = frames[0].tangent;
+	Vector3 r = frames[0].normal;
+	r = r - t * dot_product(t, r);
+	r = r.length_sq() > 1e-12 ? r.normalized() : any_perpendicular(t);
+
+	/* parallel transport by double reflection: reflect the frame through
+	 * the plane bisecting the two samples, then through the plane bisecting
+	 * the reflected and the actual tangent.
+	 * (Wang et al. "Computation of rotation minimizing frames", 2008)
+	 */
+	for(int i=0; i<mg.nrings; i++) {
+		if(i > 0) {
+			Vector3 next_t = frames[i].tangent;
+
+			Vector3 v1 = frames[i].pos - frames[i - 1].pos;
+			float c1 = dot_product(v1, v1);
+			if(c1 > 1e-12) {
+				r = r - v1 * (2.0f * dot_product(v1, r) / c1);
+				t = t - v1 * (2.0f * dot_product(v1, t) / c1);
+			}
+			Vector3 v2 = next_t - t;
+			float c2 = dot_product(v2, v2);
+			if(c2 > 1e-12) {
+				r = r - v2 * (2.0f * dot_product(v2, r) / c2);
+			}
+			t = next_t;
+
+			// keep r unit length and perpendicular to t despite rounding
+			r = r - t * dot_product(t, r);
+			r = r.length_sq() > 1e-12 ? r.normalized() : any_perpendicular(t);
+		}
+
+		MeshRing *ring = &mg.rings[i];
+		ring->origin = frames[i].pos;
+		ring->xaxis = r;
+		ring->yaxis = cross_product(t, r);
+	}
+
+	run_meshgen(&mg);
+	return true;
+}
+
+void mesh_collect(const MeshChunk &chunk, void *cls)
+{
+	Mesh *mesh = (Mesh*)cls;
+
+	// chunks may come in any order, grow the arrays to fit each one
+	unsigned int vend = chunk.first_vertex + chunk.num_verts;
+	if(mesh->verts.size() < vend) {
+		mesh->verts.resize(vend);
+		mesh->normals.resize(vend);
+		mesh->uv.resize(vend);
+	}
+	std::copy(chunk.verts, chunk.verts + chunk.num_verts, mesh->verts.begin() + chunk.first_vertex);
+	std::copy(chunk.normals, chunk.normals + chunk.num_verts, mesh->normals.begin() + chunk.first_vertex);
+	std::copy(chunk.uv, chunk.uv + chunk.num_verts, mesh->uv.begin() + chunk.first_vertex);
+
+	unsigned int iend = chunk.first_index + chunk.num_indices;
+	if(mesh->indices.size() < iend) {
+		mesh->indices.resize(iend);
+	}
+	std::copy(chunk.indices, chunk.indices + chunk.num_indices, mesh->indices.begin() + chunk.first_index);
+}
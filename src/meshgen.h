@@ -0,0 +1,97 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef MESHGEN_H_
+#define MESHGEN_H_
+
+#include <vector>
+#include "curve.h"
+#include "threadpool.h"
+
+/* Meshes are generated by sweeping a profile curve, drawn on the xy plane,
+ * and placing copies of it (rings) along the sweep. Ring i has the vertices
+ * of the profile samples, at index i * profile_samples + j, with
+ * u = i / (rings - 1) along the sweep, and v along the profile, proportional
+ * to the distance from its start. Consecutive rings are connected by two
+ * triangles per pair of profile samples. Normals point to the left of the
+ * profile (as seen drawn on the xy plane, looking down -z), and triangles are
+ * counter-clockwise seen from that side.
+ */
+
+// a range of rings of the mesh being generated
+struct MeshChunk {
+	int first_ring, num_rings;
+
+	unsigned int first_vertex;	// index of verts[0] in the whole mesh
+	int num_verts;
+	const Vector3 *verts;
+	const Vector3 *normals;
+	const Vector2 *uv;
+
+	/* triangles connecting these rings to the previous ones (none for the
+	 * first ring), as indices to the vertices of the whole mesh.
+	 */
+	unsigned int first_index;	// index of indices[0] in the whole index array
+	int num_indices;
+	const unsigned int *indices;
+};
+
+/* called with every chunk of the mesh. If a thread pool is used, it's called
+ * from the worker threads, in any order, but never concurrently.
+ */
+typedef void (*MeshChunkFunc)(const MeshChunk &chunk, void *cls);
+
+struct MeshGenOptions {
+	int profile_samples;	// vertices per ring, uniformly spaced in t
+	int rings;				// rings along the sweep, at least 2
+	int rings_per_chunk;
+	bool flip;				// reverse the normals and the winding
+	ThreadPool *pool;		// generate the chunks in parallel, if not null
+
+	MeshChunkFunc chunk_func;
+	void *chunk_cls;
+
+	MeshGenOptions();
+};
+
+/* mesh_lathe makes a surface of revolution, turning the profile around the
+ * y axis by angle (radians), from +x towards +z. For a full turn, the last
+ * ring duplicates the first, with u = 1. Profiles on the -x side of the axis
+ * come out inside-out, and need the flip option.
+ */
+bool mesh_lathe(const Curve *profile, float angle, const MeshGenOptions &opt);
+// mesh_extrude moves the profile along +z, from z = 0 to depth
+bool mesh_extrude(const Curve *profile, float depth, const MeshGenOptions &opt);
+/* mesh_sweep moves the profile along the path, evaluated at rings points
+ * uniformly spaced in t. The profile x and y axes follow the path with
+ * parallel transport (rotation minimizing) frames, starting from the normal
+ * of the path at t = 0, and its cross product with the tangent.
+ */
+bool mesh_sweep(const Curve *profile, const Curve *path, const MeshGenOptions &opt);
+
+// a whole mesh, collected from the chunks by mesh_collect
+struct Mesh {
+	std::vector<Vector3> verts;
+	std::vector<Vector3> normals;
+	std::vector<Vector2> uv;
+	std::vector<unsigned int> indices;	// triangles
+};
+
+// chunk callback which copies the chunks into a Mesh, passed as cls
+void mesh_collect(const MeshChunk &chunk, void *cls);
+
+#endif	// MESHGEN_H_
@@ -0,0 +1,585 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* the algorithms follow "The NURBS Book" by L. Piegl and W. Tiller:
+ * find_span (A2.1), basis_funcs (A2.2), insert_knot (A5.1), refine (A5.4).
+ */
+#include <math.h>
+#include <algorithm>
+#include "nurbs.h"
+
+static inline Vector4 homog(const Vector4 &p)
+{
+	return Vector4(p.x * p.w, p.y * p.w, p.z * p.w, p.w);
+}
+
+static inline Vector3 dehomog(const Vector4 &p)
+{
+	if(p.w == 0.0f) {
+		return Vector3(p.x, p.y, p.z);
+	}
+	float s = 1.0f / p.w;
+	return Vector3(p.x * s, p.y * s, p.z * s);
+}
+
+Nurbs::Nurbs(int degree)
+{
+	this->degree = std::max(1, std::min(degree, NURBS_MAX_DEGREE));
+	tess_tol = 0.0f;
+	tessvalid = false;
+}
+
+bool Nurbs::set(int degree, const float *knots, int num_knots, const Vector4 *cp, int num_cp)
+{
+	std::vector<Vector4> hcp(std::max(num_cp, 0));
+	for(int i=0; i<num_cp; i++) {
+		hcp[i] = homog(cp[i]);
+	}
+	return set_homog(degree, knots, num_knots, hcp.empty() ? 0 : &hcp[0], num_cp);
+}
+
+bool Nurbs::set_homog(int degree, const float *knots, int num_knots, const Vector4 *cp, int num_cp)
+{
+	if(degree < 1 || degree > NURBS_MAX_DEGREE || num_knots != num_cp + degree + 1) {
+		return false;
+	}
+	for(int i=1; i<num_knots; i++) {
+		if(knots[i] < knots[i - 1]) {
+			return false;
+		}
+	}
+
+	this->degree = degree;
+	this->knots.assign(knots, knots + num_knots);
+	this->cp.assign(cp, cp + num_cp);
+	tessvalid = false;
+	return true;
+}
+
+bool Nurbs::set(const Curve &curve)
+{
+	int num_cp = curve.size();
+	clear();
+	if(num_cp <= 0) {
+		return true;
+	}
+
+	float dt = num_cp > 1 ? 1.0f / (float)(num_cp - 1) : 1.0f;
+
+	/* curves with 2 control points are linear whatever the type, and the
+	 * weights are only used by b-splines with more than 2 control points.
+	 */
+	if(curve.get_type() == CURVE_LINEAR || num_cp <= 2) {
+		degree = 1;
+		if(num_cp == 1) {
+			Vector3 p = curve.get_point3(0);
+			cp.assign(2, Vector4(p.x, p.y, p.z, 1.0f));
+			float kv[] = {0.0f, 0.0f, 1.0f, 1.0f};
+			knots.assign(kv, kv + 4);
+			return true;
+		}
+
+		cp.resize(num_cp);
+		knots.resize(num_cp + 2);
+		knots[0] = 0.0f;
+		for(int i=0; i<num_cp; i++) {
+			Vector3 p = curve.get_point3(i);
+			cp[i] = Vector4(p.x, p.y, p.z, 1.0f);
+			knots[i + 1] = (float)i * dt;
+		}
+		knots[num_cp + 1] = 1.0f;
+		return true;
+	}
+
+	degree = 3;
+
+	if(curve.get_type() == CURVE_BSPLINE) {
+		/* uniform cubic, with the end points doubled (like the neighbour
+		 * clamping of Curve). Curve evaluates b-splines in homogeneous
+		 * coordinates, so its control points are used as they are.
+		 */
+		cp.resize(num_cp + 2);
+		cp[0] = curve.get_point(0);
+		for(int i=0; i<num_cp; i++) {
+			cp[i + 1] = curve.get_point(i);
+		}
+		cp[num_cp + 1] = curve.get_point(num_cp - 1);
+
+		knots.resize(num_cp + 6);
+		for(int i=0; i<num_cp + 6; i++) {
+			knots[i] = (float)(i - 3) * dt;
+		}
+		return true;
+	}
+
+	// hermite (catmull-rom): a cubic bezier per segment, joined at triple knots
+	cp.resize((num_cp - 1) * 3 + 1);
+	knots.resize(num_cp * 3 + 2);
+	cp[0] = Vector4(0, 0, 0, 1);
+
+	for(int i=0; i<num_cp - 1; i++) {
+		Vector3 prev = curve.get_point3(i > 0 ? i - 1 : i);
+		Vector3 a = curve.get_point3(i);
+		Vector3 b = curve.get_point3(i + 1);
+		Vector3 next = curve.get_point3(i + 2 < num_cp ? i + 2 : i + 1);
+
+		Vector3 b1 = a + (b - prev) * (1.0f / 6.0f);
+		Vector3 b2 = b - (next - a) * (1.0f / 6.0f);
+		if(i == 0) {
+			cp[0] = Vector4(a.x, a.y, a.z, 1.0f);
+		}
+		cp[i * 3 + 1] = Vector4(b1.x, b1.y, b1.z, 1.0f);
+		cp[i * 3 + 2] = Vector4(b2.x, b2.y, b2.z, 1.0f);
+		cp[i * 3 + 3] = Vector4(b.x, b.y, b.z, 1.0f);
+	}
+
+	for(int i=0; i<4; i++) {
+		knots[i] = 0.0f;
+		knots[num_cp * 3 - 2 + i] = 1.0f;
+	}
+	for(int i=1; i<num_cp - 1; i++) {
+		for(int j=0; j<3; j++) {
+			knots[i * 3 + 1 + j] = (float)i * dt;
+		}
+	}
+	return true;
+}
+
+void Nurbs::clear()
+{
+	knots.clear();
+	cp.clear();
+	tessvalid = false;
+}
+
+int Nurbs::get_degree() const
+{
+	return degree;
+}
+
+int Nurbs::size() const
+{
+	return (int)cp.size();
+}
+
+int Nurbs::num_knots() const
+{
+	return (int)knots.size();
+}
+
+float Nurbs::get_knot(int idx) const
+{
+	return knots[idx];
+}
+
+int Nurbs::num_spans() const
+{
+	if(!is_valid()) return 0;
+
+	int count = 0;
+	int num_cp = (int)cp.size();
+	for(int i=degree; i<num_cp; i++) {
+		if(knots[i] < knots[i + 1]) {
+			++count;
+		}
+	}
+	return count;
+}
+
+Vector3 Nurbs::get_point(int idx) const
+{
+	return dehomog(cp[idx]);
+}
+
+float Nurbs::get_weight(int idx) const
+{
+	return cp[idx].w;
+}
+
+const Vector4 &Nurbs::get_homog_point(int idx) const
+{
+	return cp[idx];
+}
+
+bool Nurbs::set_point(int idx, const Vector3 &p, float weight)
+{
+	if(idx < 0 || idx >= (int)cp.size()) {
+		return false;
+	}
+	cp[idx] = homog(Vector4(p.x, p.y, p.z, weight));
+	tessvalid = false;
+	return true;
+}
+
+bool Nurbs::is_valid() const
+{
+	int num_cp = (int)cp.size();
+	return num_cp > degree && (int)knots.size() == num_cp + degree + 1 &&
+		knots[degree] < knots[num_cp];
+}
+
+void Nurbs::get_domain(float *umin, float *umax) const
+{
+	if(!is_valid()) {
+		*umin = *umax = 0.0f;
+		return;
+	}
+	*umin = knots[degree];
+	*umax = knots[cp.size()];
+}
+
+void Nurbs::calc_bbox(Vector3 *bbmin, Vector3 *bbmax) const
+{
+	if(cp.empty()) {
+		*bbmin = *bbmax = Vector3(0, 0, 0);
+		return;
+	}
+
+	*bbmin = *bbmax = get_point(0);
+	for(size_t i=1; i<cp.size(); i++) {
+		Vector3 p = get_point(i);
+		for(int j=0; j<3; j++) {
+			if(p[j] < (*bbmin)[j]) (*bbmin)[j] = p[j];
+			if(p[j] > (*bbmax)[j]) (*bbmax)[j] = p[j];
+		}
+	}
+}
+
+// index i of the knot span [knot[i], knot[i + 1]) containing u
+int Nurbs::find_span(float u) const
+{
+	int n = (int)cp.size() - 1;
+	if(u >= knots[n + 1]) {
+		// the end of the domain belongs to the last non-empty span
+		int i = n;
+		while(i > degree && knots[i] == knots[n + 1]) --i;
+		return i;
+	}
+	if(u <= knots[degree]) {
+		int i = degree;
+		while(i < n && knots[i + 1] == knots[degree]) ++i;
+		return i;
+	}
+
+	int low = degree;
+	int high = n + 1;
+	int mid = (low + high) / 2;
+	while(u < knots[mid] || u >= knots[mid + 1]) {
+		if(u < knots[mid]) {
+			high = mid;
+		} else {
+			low = mid;
+		}
+		mid = (low + high) / 2;
+	}
+	return mid;
+}
+
+// same, checking the span of the previous value and its neighbours first
+int Nurbs::find_span(float u, int hint) const
+{
+	int n = (int)cp.size() - 1;
+	if(hint >= degree && hint <= n && u > knots[degree] && u < knots[n + 1]) {
+		for(int i=hint; i<=std::min(hint + 1, n); i++) {
+			if(u >= knots[i] && u < knots[i + 1]) {
+				return i;
+			}
+		}
+		if(hint > degree && u >= knots[hint - 1] && u < knots[hint]) {
+			return hint - 1;
+		}
+	}
+	return find_span(u);
+}
+
+// the degree + 1 non-zero basis functions at u in span
+void Nurbs::basis_funcs(int span, float u, float *res) const
+{
+	float left[NURBS_MAX_DEGREE + 1], right[NURBS_MAX_DEGREE + 1];
+
+	res[0] = 1.0f;
+	for(int j=1; j<=degree; j++) {
+		left[j] = u - knots[span + 1 - j];
+		right[j] = knots[span + j] - u;
+
+		float saved = 0.0f;
+		for(int r=0; r<j; r++) {
+			float denom = right[r + 1] + left[j - r];
+			float tmp = denom == 0.0f ? 0.0f : res[r] / denom;
+			res[r] = saved + right[r + 1] * tmp;
+			saved = left[j - r] * tmp;
+		}
+		res[j] = saved;
+	}
+}
+
+Vector3 Nurbs::evaluate(float u) const
+{
+	Vector3 res;
+	evaluate_batch(&u, 1, &res);
+	return res;
+}
+
+void Nurbs::evaluate_batch(const float *u, int count, Vector3 *out) const
+{
+	if(!is_valid()) {
+		Vector3 p = cp.empty() ? Vector3(0, 0, 0) : get_point(0);
+		for(int i=0; i<count; i++) {
+			out[i] = p;
+		}
+		return;
+	}
+
+	float umin = knots[degree];
+	float umax = knots[cp.size()];
+	float basis[NURBS_MAX_DEGREE + 1];
+	int span = -1;
+
+	for(int i=0; i<count; i++) {
+		float t = std::max(umin, std::min(u[i], umax));
+		span = find_span(t, span);
+		basis_funcs(span, t, basis);
+
+		const Vector4 *pw = &cp[span - degree];
+		Vector4 sum = pw[0] * basis[0];
+		for(int j=1; j<=degree; j++) {
+			sum += pw[j] * basis[j];
+		}
+		out[i] = dehomog(sum);
+	}
+}
+
+void Nurbs::tessellate(int samples, Vector3 *out) const
+{
+	if(samples <= 0) return;
+
+	float umin, umax;
+	get_domain(&umin, &umax);
+
+	const int chunk = 64;
+	float u[chunk];
+	for(int i=0; i<samples; i+=chunk) {
+		int n = std::min(samples - i, chunk);
+		for(int j=0; j<n; j++) {
+			float t = samples > 1 ? (float)(i + j) / (float)(samples - 1) : 0.0f;
+			u[j] = umin + (umax - umin) * t;
+		}
+		evaluate_batch(u, n, out + i);
+	}
+}
+
+/* a polynomial span of degree p, whose control points have second
+ * differences of length up to d, is within p (p - 1) d / (8 n^2) of its
+ * polyline of n uniform steps. That's a bound for uniform knots, and an
+ * estimate otherwise, or with the projected control points of rational
+ * curves.
+ */
+#define MAX_SPAN_STEPS	256
+
+int Nurbs::span_steps(int span, float tol) const
+{
+	float maxd = 0.0f;
+	for(int i=span-degree+2; i<=span; i++) {
+		Vector3 d = get_point(i) - get_point(i - 1) * 2.0f + get_point(i - 2);
+		maxd = std::max(maxd, d.length());
+	}
+
+	float err = (float)(degree * (degree - 1)) * maxd / 8.0f;
+	if(tol <= 0.0f || err >= tol * MAX_SPAN_STEPS * MAX_SPAN_STEPS) {
+		return err > 0.0f ? MAX_SPAN_STEPS : 1;
+	}
+	return std::max((int)ceil(sqrt(err / tol)), 1);
+}
+
+const std::vector<Vector3> &Nurbs::get_tessellation(float tol) const
+{
+	if(tessvalid && tol == tess_tol) {
+		return tess;
+	}
+
+	tess.clear();
+	if(is_valid()) {
+		std::vector<float> u;
+		int num_cp = (int)cp.size();
+		for(int i=degree; i<num_cp; i++) {
+			float k0 = knots[i];
+			float k1 = knots[i + 1];
+			if(k0 >= k1) continue;
+
+			int steps = span_steps(i, tol);
+			for(int j=0; j<steps; j++) {
+				u.push_back(k0 + (k1 - k0) * (float)j / (float)steps);
+			}
+		}
+		u.push_back(knots[num_cp]);
+
+		tess.resize(u.size());
+		evaluate_batch(&u[0], (int)u.size(), &tess[0]);
+	}
+	tess_tol = tol;
+	tessvalid = true;
+	return tess;
+}
+
+int Nurbs::insert_knot(float u, int times)
+{
+	if(!is_valid() || times <= 0) return 0;
+
+	int np = (int)cp.size() - 1;
+	int p = degree;
+	if(u <= knots[p] || u >= knots[np + 1]) {
+		return 0;
+	}
+
+	int k = find_span(u);
+	int s = 0;		// multiplicity of u
+	for(int i=k; i>=0 && knots[i] == u; i--) {
+		++s;
+	}
+	int r = std::min(times, p - s);
+	if(r <= 0) return 0;
+
+	std::vector<float> uq(knots.size() + r);
+	for(int i=0; i<=k; i++) {
+		uq[i] = knots[i];
+	}
+	for(int i=1; i<=r; i++) {
+		uq[k + i] = u;
+	}
+	for(int i=k+1; i<(int)knots.size(); i++) {
+		uq[i + r] = knots[i];
+	}
+
+	std::vector<Vector4> qw(cp.size() + r);
+	Vector4 rw[NURBS_MAX_DEGREE + 1];
+	for(int i=0; i<=k-p; i++) {
+		qw[i] = cp[i];
+	}
+	for(int i=k-s; i<=np; i++) {
+		qw[i + r] = cp[i];
+	}
+	for(int i=0; i<=p-s; i++) {
+		rw[i] = cp[k - p + i];
+	}
+
+	int L = 0;
+	for(int j=1; j<=r; j++) {
+		L = k - p + j;
+		for(int i=0; i<=p-j-s; i++) {
+			float alpha = (u - knots[L + i]) / (knots[i + k + 1] - knots[L + i]);
+			rw[i] = rw[i + 1] * alpha + rw[i] * (1.0f - alpha);
+		}
+		qw[L] = rw[0];
+		qw[k + r - j - s] = rw[p - j - s];
+	}
+	for(int i=L+1; i<k-s; i++) {
+		qw[i] = rw[i - L];
+	}
+
+	knots.swap(uq);
+	cp.swap(qw);
+	tessvalid = false;
+	return r;
+}
+
+void Nurbs::refine(const float *u, int count)
+{
+	if(!is_valid() || count <= 0) return;
+
+	int n = (int)cp.size() - 1;
+	int p = degree;
+	int m = n + p + 1;
+
+	// only knots in the interior of the domain change anything
+	std::vector<float> x;
+	x.reserve(count);
+	for(int i=0; i<count; i++) {
+		if(u[i] > knots[p] && u[i] < knots[n + 1]) {
+			x.push_back(u[i]);
+		}
+	}
+	if(x.empty()) return;
+	int r = (int)x.size() - 1;
+
+	int a = find_span(x[0]);
+	int b = find_span(x[r]) + 1;
+
+	std::vector<float> ubar(m + r + 2);
+	std::vector<Vector4> qw(n + r + 2);
+
+	for(int j=0; j<=a-p; j++) {
+		qw[j] = cp[j];
+	}
+	for(int j=b-1; j<=n; j++) {
+		qw[j + r + 1] = cp[j];
+	}
+	for(int j=0; j<=a; j++) {
+		ubar[j] = knots[j];
+	}
+	for(int j=b+p; j<=m; j++) {
+		ubar[j + r + 1] = knots[j];
+	}
+
+	int i = b + p - 1;
+	int k = b + p + r;
+	for(int j=r; j>=0; j--) {
+		while(x[j] <= knots[i] && i > a) {
+			qw[k - p - 1] = cp[i - p - 1];
+			ubar[k] = knots[i];
+			--k;
+			--i;
+		}
+		qw[k - p - 1] = qw[k - p];
+
+		for(int l=1; l<=p; l++) {
+			int ind = k - p + l;
+			float alpha = ubar[k + l] - x[j];
+			if(alpha == 0.0f) {
+				qw[ind - 1] = qw[ind];
+			} else {
+				alpha /= ubar[k + l] - knots[i - p + l];
+				qw[ind - 1] = qw[ind - 1] * alpha + qw[ind] * (1.0f - alpha);
+			}
+		}
+		ubar[k] = x[j];
+		--k;
+	}
+
+	knots.swap(ubar);
+	cp.swap(qw);
+	tessvalid = false;
+}
+
+void Nurbs::refine_uniform(int subdiv)
+{
+	if(!is_valid() || subdiv <= 1) return;
+
+	std::vector<float> x;
+	int num_cp = (int)cp.size();
+	for(int i=degree; i<num_cp; i++) {
+		float k0 = knots[i];
+		float k1 = knots[i + 1];
+		if(k0 >= k1) continue;
+
+		for(int j=1; j<subdiv; j++) {
+			x.push_back(k0 + (k1 - k0) * (float)j / (float)subdiv);
+		}
+	}
+	if(!x.empty()) {
+		refine(&x[0], (int)x.size());
+	}
+}
@@ -0,0 +1,109 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef NURBS_H_
+#define NURBS_H_
+
+#include <vector>
+#include "curve.h"
+
+#define NURBS_MAX_DEGREE	15
+
+/* non-uniform rational b-spline curve of arbitrary degree (up to
+ * NURBS_MAX_DEGREE). A curve with n control points of degree p has n + p + 1
+ * knots, and is defined over [knot[p], knot[n]]. Control points are given as
+ * positions and weights, and stored in homogeneous form (x w, y w, z w, w).
+ */
+class Nurbs {
+private:
+	int degree;
+	std::vector<float> knots;
+	std::vector<Vector4> cp;	// homogeneous
+
+	// cached tessellation (see get_tessellation)
+	mutable std::vector<Vector3> tess;
+	mutable float tess_tol;
+	mutable bool tessvalid;
+
+	int find_span(float u) const;
+	int find_span(float u, int hint) const;
+	void basis_funcs(int span, float u, float *res) const;
+	int span_steps(int span, float tol) const;
+
+public:
+	explicit Nurbs(int degree = 3);
+
+	/* replace the curve, returns false if the degree is out of range, the
+	 * number of knots doesn't match, or the knots are decreasing.
+	 * cp are positions (xyz) and weights (w).
+	 */
+	bool set(int degree, const float *knots, int num_knots, const Vector4 *cp, int num_cp);
+	// same as above, with control points in homogeneous form, used as they are
+	bool set_homog(int degree, const float *knots, int num_knots, const Vector4 *cp, int num_cp);
+	/* the same curve as a Curve of any type (exact): linear curves become
+	 * degree 1, b-splines uniform cubics, and hermite curves cubic beziers
+	 * joined at triple knots.
+	 */
+	bool set(const Curve &curve);
+	void clear();
+
+	int get_degree() const;
+	int size() const;			// number of control points
+	int num_knots() const;
+	float get_knot(int idx) const;
+	int num_spans() const;		// number of non-empty knot spans in the domain
+
+	Vector3 get_point(int idx) const;
+	float get_weight(int idx) const;
+	// control point as stored (homogeneous), for writing it out exactly
+	const Vector4 &get_homog_point(int idx) const;
+	bool set_point(int idx, const Vector3 &p, float weight = 1.0f);
+
+	// valid curves have at least degree + 1 control points, and a non-empty domain
+	bool is_valid() const;
+	void get_domain(float *umin, float *umax) const;
+
+	// bounds of the control points, which contain the curve for positive weights
+	void calc_bbox(Vector3 *bbmin, Vector3 *bbmax) const;
+
+	// evaluate at u in the domain (clamped)
+	Vector3 evaluate(float u) const;
+	/* evaluate at count parameter values. The knot span found for each value
+	 * is the starting point of the search for the next, so runs of increasing
+	 * (or decreasing) values only compute the basis functions of each point.
+	 */
+	void evaluate_batch(const float *u, int count, Vector3 *out) const;
+	// evaluate at samples values uniformly spaced over the domain
+	void tessellate(int samples, Vector3 *out) const;
+	/* polyline within about tol of the curve, with each knot span split in
+	 * as many uniform steps as its control points call for. The result is
+	 * cached, until the curve is modified or a different tol is requested.
+	 */
+	const std::vector<Vector3> &get_tessellation(float tol) const;
+
+	/* insert the knot u (in the interior of the domain) up to times times,
+	 * without changing the shape of the curve, limited to a multiplicity of
+	 * degree. Returns the number of times it was inserted.
+	 */
+	int insert_knot(float u, int times = 1);
+	// insert all the knots in u, which must be sorted
+	void refine(const float *u, int count);
+	// split every non-empty knot span in subdiv equal spans
+	void refine_uniform(int subdiv);
+};
+
+#endif	// NURBS_H_
@@ -0,0 +1,417 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+#include <utility>
+#include "pointindex.h"
+
+// cell coordinates are clamped to this range, to keep ring arithmetic in range
+#define MAX_CELL	(1 << 30)
+
+static inline long long cell_key(int cx, int cy)
+{
+	return ((long long)cx << 32) | (unsigned int)cy;
+}
+
+static inline void cell_of_key(long long key, int *cx, int *cy)
+{
+	*cx = (int)(key >> 32);
+	*cy = (int)(unsigned int)(key & 0xffffffff);
+}
+
+PointIndex::PointIndex(float cell_size)
+{
+	this->cell_size = cell_size > 0.0f ? cell_size : 1.0f;
+	freelist = -1;
+	clear();
+}
+
+void PointIndex::clear()
+{
+	entries.clear();
+	recs.clear();
+	cells.clear();
+	freelist = -1;
+	num_points = 0;
+	cmin[0] = cmin[1] = MAX_CELL;
+	cmax[0] = cmax[1] = -MAX_CELL;
+}
+
+void PointIndex::set_cell_size(float sz)
+{
+	if(sz <= 0.0f || sz == cell_size) return;
+	cell_size = sz;
+
+	cells.clear();
+	cmin[0] = cmin[1] = MAX_CELL;
+	cmax[0] = cmax[1] = -MAX_CELL;
+
+	std::map<const Curve*, CurveRec>::iterator it = recs.begin();
+	while(it != recs.end()) {
+		const std::vector<int> &ent = it->second.entries;
+		for(size_t i=0; i<ent.size(); i++) {
+			place_entry(ent[i]);
+		}
+		++it;
+	}
+}
+
+float PointIndex::get_cell_size() const
+{
+	return cell_size;
+}
+
+void PointIndex::cell_coords(const Vector2 &p, int *cx, int *cy) const
+{
+	float fx = floor(p.x / cell_size);
+	float fy = floor(p.y / cell_size);
+	// also catches NaN
+	*cx = fx > -MAX_CELL ? (fx < MAX_CELL ? (int)fx : MAX_CELL) : -MAX_CELL;
+	*cy = fy > -MAX_CELL ? (fy < MAX_CELL ? (int)fy : MAX_CELL) : -MAX_CELL;
+}
+
+void PointIndex::place_entry(int eidx)
+{
+	Entry *e = &entries[eidx];
+
+	int cx, cy;
+	cell_coords(e->pos, &cx, &cy);
+	e->cell = cell_key(cx, cy);
+
+	std::vector<int> *cell = &cells[e->cell];
+	e->slot = (int)cell->size();
+	cell->push_back(eidx);
+
+	cmin[0] = std::min(cmin[0], cx);
+	cmin[1] = std::min(cmin[1], cy);
+	cmax[0] = std::max(cmax[0], cx);
+	cmax[1] = std::max(cmax[1], cy);
+}
+
+void PointIndex::unplace_entry(int eidx)
+{
+	const Entry &e = entries[eidx];
+	std::unordered_map<long long, std::vector<int> >::iterator it = cells.find(e.cell);
+	std::vector<int> *cell = &it->second;
+
+	int last = cell->back();
+	(*cell)[e.slot] = last;
+	entries[last].slot = e.slot;
+	cell->pop_back();
+
+	if(cell->empty()) {
+		cells.erase(it);
+	}
+}
+
+int PointIndex::add_entry(Curve *curve, int idx)
+{
+	int eidx;
+	if(freelist != -1) {
+		eidx = freelist;
+		freelist = entries[eidx].slot;
+	} else {
+		eidx = (int)entries.size();
+		entries.push_back(Entry());
+	}
+
+	Entry *e = &entries[eidx];
+	e->curve = curve;
+	e->idx = idx;
+	e->pos = curve->get_point2(idx);
+	place_entry(eidx);
+	++num_points;
+	return eidx;
+}
+
+void PointIndex::remove_entry(int eidx)
+{
+	unplace_entry(eidx);
+	entries[eidx].curve = 0;
+	entries[eidx].slot = freelist;
+	freelist = eidx;
+	--num_points;
+}
+
+void PointIndex::add_points(Curve *curve, CurveRec *rec)
+{
+	int num = curve->size();
+	rec->entries.resize(num);
+	for(int i=0; i<num; i++) {
+		rec->entries[i] = add_entry(curve, i);
+	}
+	rec->version = curve->get_version();
+}
+
+void PointIndex::remove_points(CurveRec *rec)
+{
+	for(size_t i=0; i<rec->entries.size(); i++) {
+		remove_entry(rec->entries[i]);
+	}
+	rec->entries.clear();
+}
+
+bool PointIndex::add(Curve *curve)
+{
+	if(recs.find(curve) != recs.end()) {
+		return false;
+	}
+	add_points(curve, &recs[curve]);
+	return true;
+}
+
+bool PointIndex::remove(const Curve *curve)
+{
+	std::map<const Curve*, CurveRec>::iterator it = recs.find(curve);
+	if(it == recs.end()) {
+		return false;
+	}
+	remove_points(&it->second);
+	recs.erase(it);
+	return true;
+}
+
+bool PointIndex::update(Curve *curve)
+{
+	std::map<const Curve*, CurveRec>::iterator it = recs.find(curve);
+	if(it == recs.end()) {
+		return false;
+	}
+	CurveRec *rec = &it->second;
+	if(rec->version == curve->get_version()) {
+		return true;
+	}
+
+	if((int)rec->entries.size() != curve->size()) {
+		// points were added or removed, and the indices may have shifted
+		remove_points(rec);
+		add_points(curve, rec);
+		return true;
+	}
+
+	for(size_t i=0; i<rec->entries.size(); i++) {
+		update_point(curve, i);
+	}
+	rec->version = curve->get_version();
+	return true;
+}
+
+bool PointIndex::update_point(const Curve *curve, int idx)
+{
+	std::map<const Curve*, CurveRec>::iterator it = recs.find(curve);
+	if(it == recs.end() || idx < 0 || idx >= (int)it->second.entries.size()) {
+		return false;
+	}
+	CurveRec *rec = &it->second;
+
+	int eidx = rec->entries[idx];
+	Vector2 pos = curve->get_point2(idx);
+	int cx, cy;
+	cell_coords(pos, &cx, &cy);
+
+	entries[eidx].pos = pos;
+	if(cell_key(cx, cy) != entries[eidx].cell) {
+		unplace_entry(eidx);
+		place_entry(eidx);
+	}
+	rec->version = curve->get_version();
+	return true;
+}
+
+bool PointIndex::contains(const Curve *curve) const
+{
+	return recs.find(curve) != recs.end();
+}
+
+int PointIndex::size() const
+{
+	return num_points;
+}
+
+int PointIndex::query_radius(const Vector2 &p, float radius, std::vector<PointRef> *res,
+		PointIgnoreFunc ignore, void *cls) const
+{
+	if(cells.empty() || radius < 0.0f) return 0;
+
+	float rsq = radius * radius;
+	int count = 0;
+
+	int x0, y0, x1, y1;
+	cell_coords(p - Vector2(radius, radius), &x0, &y0);
+	cell_coords(p + Vector2(radius, radius), &x1, &y1);
+	x0 = std::max(x0, cmin[0]);
+	y0 = std::max(y0, cmin[1]);
+	x1 = std::min(x1, cmax[0]);
+	y1 = std::min(y1, cmax[1]);
+	if(x0 > x1 || y0 > y1) return 0;
+
+	// if the range spans more cells than are occupied, just visit the occupied ones
+	long long ncells = (long long)(x1 - x0 + 1) * (long long)(y1 - y0 + 1);
+	if(ncells > (long long)cells.size()) {
+		std::unordered_map<long long, std::vector<int> >::const_iterator it = cells.begin();
+		while(it != cells.end()) {
+			count += collect_cell(it->second, p, rsq, res, ignore, cls);
+			++it;
+		}
+	} else {
+		for(int y=y0; y<=y1; y++) {
+			for(int x=x0; x<=x1; x++) {
+				std::unordered_map<long long, std::vector<int> >::const_iterator it =
+					cells.find(cell_key(x, y));
+				if(it != cells.end()) {
+					count += collect_cell(it->second, p, rsq, res, ignore, cls);
+				}
+			}
+		}
+	}
+	return count;
+}
+
+int PointIndex::collect_cell(const std::vector<int> &cell, const Vector2 &p, float rsq,
+		std::vector<PointRef> *res, PointIgnoreFunc ignore, void *cls) const
+{
+	int count = 0;
+	for(size_t i=0; i<cell.size(); i++) {
+		const Entry &e = entries[cell[i]];
+		if((e.pos - p).length_sq() > rsq) continue;
+		if(ignore && ignore(e.curve, e.idx, cls)) continue;
+
+		PointRef ref;
+		ref.curve = e.curve;
+		ref.idx = e.idx;
+		res->push_back(ref);
+		++count;
+	}
+	return count;
+}
+
+// max-heap of the best k candidates found so far, by distance
+struct PointIndex::NearestSearch {
+	Vector2 p;
+	int k;
+	float maxdsq;
+	PointIgnoreFunc ignore;
+	void *cls;
+	std::vector<std::pair<float, int> > heap;
+
+	float worst() const
+	{
+		return (int)heap.size() < k ? maxdsq : heap.front().first;
+	}
+};
+
+void PointIndex::visit_cell(NearestSearch *ns, const std::vector<int> &cell) const
+{
+	for(size_t i=0; i<cell.size(); i++) {
+		const Entry &e = entries[cell[i]];
+		float dsq = (e.pos - ns->p).length_sq();
+		if(dsq > ns->worst()) continue;
+		if(ns->ignore && ns->ignore(e.curve, e.idx, ns->cls)) continue;
+
+		if((int)ns->heap.size() >= ns->k) {
+			std::pop_heap(ns->heap.begin(), ns->heap.end());
+			ns->heap.pop_back();
+		}
+		ns->heap.push_back(std::make_pair(dsq, cell[i]));
+		std::push_heap(ns->heap.begin(), ns->heap.end());
+	}
+}
+
+int PointIndex::query_nearest(const Vector2 &p, int k, PointRef *res, float *distsq,
+		float maxdist, PointIgnoreFunc ignore, void *cls) const
+{
+	if(cells.empty() || k <= 0) return 0;
+
+	NearestSearch ns;
+	ns.p = p;
+	ns.k = k;
+	ns.maxdsq = maxdist < 0.0f ? FLT_MAX : maxdist * maxdist;
+	ns.ignore = ignore;
+	ns.cls = cls;
+	ns.heap.reserve(k + 1);
+
+	int cx, cy;
+	cell_coords(p, &cx, &cy);
+
+	/* visit rings of cells of increasing chebyshev distance from the cell of p.
+	 * Any point in ring r is at least (r - 1) * cell_size away, so we can stop
+	 * as soon as that exceeds the current k-th best distance.
+	 */
+	for(long long r=0; ; r++) {
+		if(r > 0) {
+			float mind = (float)(r - 1) * cell_size;
+			if(mind * mind > ns.worst()) break;
+		}
+
+		long long rx0 = cx - r, rx1 = cx + r;
+		long long ry0 = cy - r, ry1 = cy + r;
+		if(8 * r > (long long)cells.size()) {
+			// the ring has more cells than there are occupied cells: visit the rest directly
+			std::unordered_map<long long, std::vector<int> >::const_iterator it = cells.begin();
+			while(it != cells.end()) {
+				int x, y;
+				cell_of_key(it->first, &x, &y);
+				long long dx = x > cx ? (long long)x - cx : (long long)cx - x;
+				long long dy = y > cy ? (long long)y - cy : (long long)cy - y;
+				if(std::max(dx, dy) >= r) {
+					visit_cell(&ns, it->second);
+				}
+				++it;
+			}
+			break;
+		}
+
+		for(long long x=rx0; x<=rx1; x++) {
+			for(long long y=ry0; y<=ry1; y += (x == rx0 || x == rx1 || r == 0) ? 1 : ry1 - ry0) {
+				if(x < cmin[0] || x > cmax[0] || y < cmin[1] || y > cmax[1]) continue;
+
+				std::unordered_map<long long, std::vector<int> >::const_iterator it =
+					cells.find(cell_key((int)x, (int)y));
+				if(it != cells.end()) {
+					visit_cell(&ns, it->second);
+				}
+			}
+		}
+
+		if(rx0 <= cmin[0] && ry0 <= cmin[1] && rx1 >= cmax[0] && ry1 >= cmax[1]) {
+			break;	// covered every occupied cell
+		}
+	}
+
+	std::sort_heap(ns.heap.begin(), ns.heap.end());
+
+	int count = (int)ns.heap.size();
+	for(int i=0; i<count; i++) {
+		const Entry &e = entries[ns.heap[i].second];
+		if(res) {
+			res[i].curve = e.curve;
+			res[i].idx = e.idx;
+		}
+		if(distsq) {
+			distsq[i] = ns.heap[i].first;
+		}
+	}
+	return count;
+}
+
+bool PointIndex::nearest(const Vector2 &p, PointRef *res, float maxdist,
+		PointIgnoreFunc ignore, void *cls) const
+{
+	return query_nearest(p, 1, res, 0, maxdist, ignore, cls) == 1;
+}
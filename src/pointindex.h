@@ -0,0 +1,107 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef POINTINDEX_H_
+#define POINTINDEX_H_
+
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include "curve.h"
+
+struct PointRef {
+	Curve *curve;
+	int idx;
+};
+
+// query callback, return true to skip a point
+typedef bool (*PointIgnoreFunc)(const Curve *curve, int idx, void *cls);
+
+/* spatial hash over the control points (on the XY plane) of a set of curves,
+ * for nearest point snapping and point picking.
+ */
+class PointIndex {
+private:
+	struct Entry {
+		Curve *curve;
+		int idx;
+		Vector2 pos;
+		long long cell;
+		int slot;		// position in the cell's entry list, or the free list link
+	};
+	std::vector<Entry> entries;
+	int freelist;
+	int num_points;
+
+	struct CurveRec {
+		std::vector<int> entries;	// entry of each control point
+		unsigned int version;
+	};
+	std::map<const Curve*, CurveRec> recs;
+
+	std::unordered_map<long long, std::vector<int> > cells;
+	int cmin[2], cmax[2];		// range of cells ever occupied since the last clear
+	float cell_size;
+
+	void cell_coords(const Vector2 &p, int *cx, int *cy) const;
+	int add_entry(Curve *curve, int idx);
+	void remove_entry(int eidx);
+	void place_entry(int eidx);
+	void unplace_entry(int eidx);
+	void add_points(Curve *curve, CurveRec *rec);
+	void remove_points(CurveRec *rec);
+
+	int collect_cell(const std::vector<int> &cell, const Vector2 &p, float rsq,
+			std::vector<PointRef> *res, PointIgnoreFunc ignore, void *cls) const;
+
+	struct NearestSearch;
+	void visit_cell(NearestSearch *ns, const std::vector<int> &cell) const;
+
+public:
+	PointIndex(float cell_size = 1.0f);
+
+	void clear();
+	// changing the cell size re-inserts all points
+	void set_cell_size(float sz);
+	float get_cell_size() const;
+
+	bool add(Curve *curve);
+	bool remove(const Curve *curve);
+	// call after points were added, removed or moved, does nothing if unchanged
+	bool update(Curve *curve);
+	// cheaper update when only point idx was moved
+	bool update_point(const Curve *curve, int idx);
+
+	bool contains(const Curve *curve) const;
+	int size() const;
+
+	/* query_radius appends all points within radius of p to res, and returns
+	 * how many were found. query_nearest writes up to k points closest to p
+	 * and their squared distances (either may be null) sorted by distance,
+	 * and returns how many it found. Points for which the optional ignore
+	 * function returns true are skipped.
+	 */
+	int query_radius(const Vector2 &p, float radius, std::vector<PointRef> *res,
+			PointIgnoreFunc ignore = 0, void *cls = 0) const;
+	int query_nearest(const Vector2 &p, int k, PointRef *res, float *distsq = 0,
+			float maxdist = -1.0f, PointIgnoreFunc ignore = 0, void *cls = 0) const;
+	// convenience wrapper for k = 1
+	bool nearest(const Vector2 &p, PointRef *res, float maxdist = -1.0f,
+			PointIgnoreFunc ignore = 0, void *cls = 0) const;
+};
+
+#endif	// POINTINDEX_H_
@@ -0,0 +1,128 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include "scenetess.h"
+
+// approximate number of segments flattened by each task
+#define SEGS_PER_TASK	256
+
+struct TessJob {
+	int first, count;	// range of whole curves, or the curve split
+	int first_seg, num_seg;	// range of segments, if num_seg > 0
+	std::vector<Vector3> verts;	// vertices of a range of segments
+};
+
+struct SceneTess {
+	const Curve * const *curves;
+	float tol;
+	std::vector<Vector3> *out;
+	std::vector<TessJob> jobs;
+};
+
+static void tess_job(int idx, void *cls)
+{
+	SceneTess *st = (SceneTess*)cls;
+	TessJob *job = &st->jobs[idx];
+
+	if(job->num_seg > 0) {
+		st->curves[job->first]->tessellate_adaptive_range(st->tol, job->first_seg,
+				job->num_seg, &job->verts);
+		return;
+	}
+
+	for(int i=0; i<job->count; i++) {
+		int cidx = job->first + i;
+		st->out[cidx].clear();
+		st->curves[cidx]->tessellate_adaptive(st->tol, &st->out[cidx]);
+	}
+}
+
+static void add_job(SceneTess *st, int first, int count, int first_seg, int num_seg)
+{
+	st->jobs.push_back(TessJob());
+	TessJob *job = &st->jobs.back();
+	job->first = first;
+	job->count = count;
+	job->first_seg = first_seg;
+	job->num_seg = num_seg;
+}
+
+void tessellate_scene(ThreadPool *pool, const Curve * const *curves, int count,
+		float tol, std::vector<Vector3> *out)
+{
+	if(count <= 0) return;
+
+	SceneTess st;
+	st.curves = curves;
+	st.tol = tol;
+	st.out = out;
+
+	int group_start = 0, group_segs = 0;
+	for(int i=0; i<count; i++) {
+		int nseg = curves[i]->num_segments();
+
+		if(nseg <= SEGS_PER_TASK) {
+			group_segs += nseg + 1;
+			if(group_segs >= SEGS_PER_TASK) {
+				add_job(&st, group_start, i + 1 - group_start, 0, 0);
+				group_start = i + 1;
+				group_segs = 0;
+			}
+			continue;
+		}
+
+		if(i > group_start) {
+			add_job(&st, group_start, i - group_start, 0, 0);
+		}
+		group_start = i + 1;
+		group_segs = 0;
+
+		/* the pieces of a split curve are flattened concurrently, so calculate
+		 * its lazily evaluated data now, instead of in the tasks.
+		 */
+		curves[i]->prepare();
+		for(int j=0; j<nseg; j+=SEGS_PER_TASK) {
+			add_job(&st, i, 1, j, std::min(SEGS_PER_TASK, nseg - j));
+		}
+	}
+	if(group_start < count) {
+		add_job(&st, group_start, count - group_start, 0, 0);
+	}
+
+	int num_jobs = (int)st.jobs.size();
+	if(pool && num_jobs > 1) {
+		pool->parallel_for(num_jobs, tess_job, &st);
+	} else {
+		for(int i=0; i<num_jobs; i++) {
+			tess_job(i, &st);
+		}
+	}
+
+	// join the pieces of split curves, after their start point
+	for(int i=0; i<num_jobs; i++) {
+		TessJob *job = &st.jobs[i];
+		if(job->num_seg <= 0) continue;
+
+		std::vector<Vector3> *verts = out + job->first;
+		if(job->first_seg == 0) {
+			verts->clear();
+			verts->push_back(curves[job->first]->interpolate(0.0f));
+		}
+		verts->insert(verts->end(), job->verts.begin(), job->verts.end());
+	}
+}
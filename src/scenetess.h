@@ -0,0 +1,36 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SCENETESS_H_
+#define SCENETESS_H_
+
+#include <vector>
+#include "curve.h"
+#include "threadpool.h"
+
+/* tessellate_scene runs tessellate_adaptive(tol) for count curves, in
+ * parallel on the thread pool (or serially if pool is null), and writes the
+ * vertices of each curve in the corresponding out vector, replacing its
+ * contents. Short curves are grouped into tasks, long curves are split into
+ * ranges of segments; either way the results are identical to calling
+ * tessellate_adaptive for each curve in turn.
+ * The curves must be distinct, and not modified until it returns.
+ */
+void tessellate_scene(ThreadPool *pool, const Curve * const *curves, int count,
+		float tol, std::vector<Vector3> *out);
+
+#endif	// SCENETESS_H_
@@ -0,0 +1,267 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* polyline stroking.
+ *
+ * The strip is a sequence of (left, right) vertex pairs, with left and right
+ * relative to the direction of the polyline. Every join is a fan around a
+ * point on its inner side: the outer points of the join (one for miters, two
+ * for bevels, an arc for round joins) are each paired with the inner point,
+ * and every other triangle of the fan is degenerate. Caps are made the same
+ * way, pairing up points on either side of the cap.
+ */
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+#include "stroke.h"
+
+#define MAX_ARC_STEPS	64
+
+StrokeStyle::StrokeStyle(float width, StrokeJoin join, StrokeCap cap)
+{
+	this->width = width;
+	this->join = join;
+	this->cap = cap;
+	miter_limit = 4.0f;
+	round_tol = 0.01f;
+}
+
+static inline float cross2(const Vector2 &a, const Vector2 &b)
+{
+	return a.x * b.y - a.y * b.x;
+}
+
+static inline float dot2(const Vector2 &a, const Vector2 &b)
+{
+	return a.x * b.x + a.y * b.y;
+}
+
+static inline Vector2 rotate2(const Vector2 &v, float angle)
+{
+	float s = sin(angle);
+	float c = cos(angle);
+	return Vector2(v.x * c - v.y * s, v.x * s + v.y * c);
+}
+
+// number of steps for an arc of the given angle and radius to be within tol
+static int arc_steps(float angle, float rad, const StrokeStyle &style)
+{
+	float tol = style.round_tol;
+	if(tol <= 0.0f || tol >= rad) {
+		tol = rad * 0.5f;
+	}
+	float step = 2.0f * acos(1.0f - tol / rad);
+	int n = (int)ceil(fabs(angle) / step);
+	return std::max(1, std::min(n, MAX_ARC_STEPS));
+}
+
+static inline void add_pair(std::vector<Vector2> *out, const Vector2 &left, const Vector2 &right)
+{
+	out->push_back(left);
+	out->push_back(right);
+}
+
+/* start cap at p, with the polyline going in direction dir, and n the
+ * left normal. The end cap is the same with dir and n negated, and left
+ * and right swapped.
+ */
+static void add_cap(std::vector<Vector2> *out, const Vector2 &p, const Vector2 &dir,
+		const Vector2 &n, float hw, const StrokeStyle &style, bool end)
+{
+	switch(style.cap) {
+	case CAP_SQUARE:
+		{
+			Vector2 q = end ? p + dir * hw : p - dir * hw;
+			add_pair(out, q + n * hw, q - n * hw);
+		}
+		break;
+
+	case CAP_ROUND:
+		{
+			// symmetric pairs, from the tip of the cap to the sides
+			int steps = arc_steps(M_PI / 2.0, hw, style);
+			Vector2 back = end ? dir * hw : -dir * hw;
+			for(int i=0; i<=steps; i++) {
+				int k = end ? steps - i : i;
+				float angle = M_PI / 2.0 * (float)k / (float)steps;
+				Vector2 a = back * cos(angle);
+				Vector2 b = n * (hw * sin(angle));
+				add_pair(out, p + a + b, p + a - b);
+			}
+		}
+		break;
+
+	case CAP_BUTT:
+	default:
+		add_pair(out, p + n * hw, p - n * hw);
+	}
+}
+
+// pair an outer point of a join with an inner one, in (left, right) order
+static inline void add_join_pair(std::vector<Vector2> *out, const Vector2 &outer,
+		const Vector2 &inner, float side)
+{
+	if(side > 0.0f) {
+		add_pair(out, outer, inner);
+	} else {
+		add_pair(out, inner, outer);
+	}
+}
+
+static void add_join(std::vector<Vector2> *out, const Vector2 &p, const Vector2 &d0,
+		const Vector2 &d1, float len0, float len1, float hw, const StrokeStyle &style)
+{
+	Vector2 n0 = Vector2(-d0.y, d0.x);
+	Vector2 n1 = Vector2(-d1.y, d1.x);
+	float turn = atan2(cross2(d0, d1), dot2(d0, d1));
+	float side = turn > 0.0f ? -1.0f : 1.0f;	// +1 if the outer side is the left
+
+	Vector2 mid = n0 + n1;
+	float mid_len = sqrt(dot2(mid, mid));
+	float cos_half = mid_len * 0.5f;	// cosine of half the turn
+	float miter_len = cos_half > 1e-4f ? hw / cos_half : FLT_MAX;
+	if(cos_half > 1e-4f) {
+		mid = mid / mid_len;
+	}
+
+	/* the fan is around the intersection of the inner offset lines, as long
+	 * as it's within half of each segment, so that it can't cross the inner
+	 * point of the next join. Otherwise the fan is around p, and the segments
+	 * end at their own inner offset points, overlapping on the inner side.
+	 */
+	float half_len = std::min(len0, len1) * 0.5f;
+	bool pivot = miter_len * miter_len > hw * hw + half_len * half_len;
+	Vector2 inner = pivot ? p : p - mid * (side * miter_len);
+
+	StrokeJoin join = style.join;
+	if(join == JOIN_MITER && miter_len > hw * style.miter_limit) {
+		join = JOIN_BEVEL;
+	}
+
+	Vector2 outer0 = p + n0 * (side * hw);
+	Vector2 outer1 = p + n1 * (side * hw);
+
+	if(pivot) {
+		add_join_pair(out, outer0, p - n0 * (side * hw), side);
+	}
+
+	switch(join) {
+	case JOIN_MITER:
+		if(pivot) {
+			add_join_pair(out, outer0, inner, side);
+		}
+		add_join_pair(out, p + mid * (side * miter_len), inner, side);
+		if(pivot) {
+			add_join_pair(out, outer1, inner, side);
+		}
+		break;
+
+	case JOIN_ROUND:
+		{
+			Vector2 v = n0 * (side * hw);
+			int steps = arc_steps(turn, hw, style);
+			for(int i=0; i<=steps; i++) {
+				add_join_pair(out, p + rotate2(v, turn * (float)i / (float)steps), inner, side);
+			}
+		}
+		break;
+
+	case JOIN_BEVEL:
+	default:
+		add_join_pair(out, outer0, inner, side);
+		add_join_pair(out, outer1, inner, side);
+	}
+
+	if(pivot) {
+		add_join_pair(out, outer1, p - n1 * (side * hw), side);
+	}
+}
+
+/* find the next segment of the polyline starting at p, skipping coincident
+ * points, which have no direction. Returns false at the end of the polyline.
+ */
+static bool next_segment(const Vector3 *verts, int count, int *idx, const Vector2 &p,
+		float min_len, Vector2 *next, Vector2 *dir, float *len)
+{
+	while(*idx < count) {
+		const Vector3 &v = verts[(*idx)++];
+		Vector2 d = Vector2(v.x - p.x, v.y - p.y);
+		float dlen = sqrt(dot2(d, d));
+		if(dlen > min_len) {
+			*next = Vector2(v.x, v.y);
+			*dir = d / dlen;
+			*len = dlen;
+			return true;
+		}
+	}
+	return false;
+}
+
+int stroke_polyline(const Vector3 *verts, int count, const StrokeStyle &style,
+		std::vector<Vector2> *out)
+{
+	float hw = style.width * 0.5f;
+	if(count < 2 || hw <= 0.0f) {
+		return 0;
+	}
+	float min_len = 1e-6f * hw;
+
+	int idx = 1;
+	Vector2 p = Vector2(verts[0].x, verts[0].y);
+	Vector2 next, dir, next_dir;
+	float len, next_len;
+
+	if(!next_segment(verts, count, &idx, p, min_len, &next, &dir, &len)) {
+		return 0;
+	}
+
+	int start = (int)out->size();
+	int bridge = -1;
+	if(start > 0) {
+		// two degenerate vertices connect to the previous strip in the buffer
+		out->push_back(out->back());
+		bridge = (int)out->size();
+		out->push_back(Vector2());
+	}
+
+	add_cap(out, p, dir, Vector2(-dir.y, dir.x), hw, style, false);
+
+	p = next;
+	while(next_segment(verts, count, &idx, p, min_len, &next, &next_dir, &next_len)) {
+		add_join(out, p, dir, next_dir, len, next_len, hw, style);
+		p = next;
+		dir = next_dir;
+		len = next_len;
+	}
+
+	add_cap(out, p, dir, Vector2(-dir.y, dir.x), hw, style, true);
+
+	if(bridge >= 0) {
+		(*out)[bridge] = (*out)[bridge + 1];
+	}
+	return (int)out->size() - start;
+}
+
+int stroke_curve(const Curve *curve, float tol, const StrokeStyle &style,
+		std::vector<Vector2> *out)
+{
+	const std::vector<Vector3> &verts = curve->get_tessellation(tol);
+	if(verts.empty()) {
+		return 0;
+	}
+	return stroke_polyline(&verts[0], (int)verts.size(), style, out);
+}
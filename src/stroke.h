@@ -0,0 +1,60 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef STROKE_H_
+#define STROKE_H_
+
+#include <vector>
+#include "curve.h"
+
+enum StrokeJoin {
+	JOIN_MITER,
+	JOIN_ROUND,
+	JOIN_BEVEL
+};
+
+enum StrokeCap {
+	CAP_BUTT,
+	CAP_SQUARE,
+	CAP_ROUND
+};
+
+struct StrokeStyle {
+	float width;
+	StrokeJoin join;
+	StrokeCap cap;
+	float miter_limit;	// miter length / half width beyond which miters are beveled
+	float round_tol;	// max distance of round joins and caps from the true circle
+
+	StrokeStyle(float width = 1.0f, StrokeJoin join = JOIN_MITER, StrokeCap cap = CAP_BUTT);
+};
+
+/* stroke_polyline outlines the polyline on the z = 0 plane (z is ignored)
+ * with a triangle strip, and appends its vertices to out. If out already
+ * has vertices, two degenerate vertices are added first to connect to them,
+ * so any number of strokes can be appended to the same buffer, and drawn at
+ * once as a single strip.
+ * The winding of the triangles isn't consistent, so draw without face
+ * culling. Returns the number of vertices appended.
+ */
+int stroke_polyline(const Vector3 *verts, int count, const StrokeStyle &style,
+		std::vector<Vector2> *out);
+// stroke the adaptive tessellation of the curve (see Curve::get_tessellation)
+int stroke_curve(const Curve *curve, float tol, const StrokeStyle &style,
+		std::vector<Vector2> *out);
+
+#endif	// STROKE_H_
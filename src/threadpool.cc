@@ -0,0 +1,189 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include "threadpool.h"
+
+// pool and queue index of the worker running on this thread, if any
+static thread_local ThreadPool *cur_pool;
+static thread_local int cur_queue = -1;
+
+ThreadPool::ThreadPool(int num_threads)
+{
+	if(num_threads <= 0) {
+		num_threads = std::max((int)std::thread::hardware_concurrency(), 1);
+	}
+
+	num_queues = num_threads;
+	queues = new Queue[num_queues];
+	num_queued = 0;
+	num_pending = 0;
+	next_queue = 0;
+	quit = false;
+
+	for(int i=0; i<num_threads; i++) {
+		threads.push_back(std::thread(&ThreadPool::worker, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	wait();
+
+	{
+		std::lock_guard<std::mutex> lk(wake_lock);
+		quit = true;
+	}
+	wake_cond.notify_all();
+
+	for(size_t i=0; i<threads.size(); i++) {
+		threads[i].join();
+	}
+	delete [] queues;
+}
+
+int ThreadPool::get_num_threads() const
+{
+	return (int)threads.size();
+}
+
+void ThreadPool::add_task(void (*func)(void*), void *cls)
+{
+	Task task;
+	task.func = func;
+	task.cls = cls;
+
+	int qidx = cur_pool == this ? cur_queue : (int)(next_queue++ % num_queues);
+
+	++num_pending;
+	{
+		std::lock_guard<std::mutex> lk(queues[qidx].lock);
+		queues[qidx].tasks.push_back(task);
+	}
+	++num_queued;
+
+	// lock to avoid racing with a worker about to go to sleep
+	{
+		std::lock_guard<std::mutex> lk(wake_lock);
+	}
+	wake_cond.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	Task task;
+	int qidx = cur_pool == this ? cur_queue : 0;
+
+	while(num_pending > 0) {
+		if(get_task(qidx, &task)) {
+			run_task(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lk(wake_lock);
+		while(num_pending > 0 && num_queued == 0) {
+			done_cond.wait(lk);
+		}
+	}
+}
+
+// take a task from the back of our own queue, or steal one from the front of another
+bool ThreadPool::get_task(int idx, Task *task)
+{
+	if(num_queued <= 0) return false;
+
+	for(int i=0; i<num_queues; i++) {
+		Queue *q = queues + (idx + i) % num_queues;
+
+		std::lock_guard<std::mutex> lk(q->lock);
+		if(q->tasks.empty()) continue;
+
+		if(i == 0) {
+			*task = q->tasks.back();
+			q->tasks.pop_back();
+		} else {
+			*task = q->tasks.front();
+			q->tasks.pop_front();
+		}
+		--num_queued;
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::run_task(const Task &task)
+{
+	task.func(task.cls);
+
+	if(--num_pending == 0) {
+		std::lock_guard<std::mutex> lk(wake_lock);
+		done_cond.notify_all();
+	}
+}
+
+void ThreadPool::worker(int idx)
+{
+	cur_pool = this;
+	cur_queue = idx;
+
+	Task task;
+	for(;;) {
+		if(get_task(idx, &task)) {
+			run_task(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lk(wake_lock);
+		while(!quit && num_queued == 0) {
+			wake_cond.wait(lk);
+		}
+		if(quit && num_queued == 0) {
+			break;
+		}
+	}
+}
+
+struct ForRange {
+	void (*func)(int, void*);
+	void *cls;
+	int start, end;
+};
+
+static void for_range_task(void *cls)
+{
+	ForRange *r = (ForRange*)cls;
+	for(int i=r->start; i<r->end; i++) {
+		r->func(i, r->cls);
+	}
+}
+
+void ThreadPool::parallel_for(int count, void (*func)(int, void*), void *cls, int grain)
+{
+	if(count <= 0) return;
+	if(grain < 1) grain = 1;
+
+	int num_ranges = (count + grain - 1) / grain;
+	std::vector<ForRange> ranges(num_ranges);
+	for(int i=0; i<num_ranges; i++) {
+		ranges[i].func = func;
+		ranges[i].cls = cls;
+		ranges[i].start = i * grain;
+		ranges[i].end = std::min(ranges[i].start + grain, count);
+		add_task(for_range_task, &ranges[i]);
+	}
+	wait();
+}
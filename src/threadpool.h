@@ -0,0 +1,83 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/* work-stealing thread pool. Every worker has its own task queue: tasks
+ * added by a worker go to its own queue and are taken from the back (most
+ * recent first), while idle workers steal from the front of other queues.
+ * Tasks added from other threads are distributed round-robin. The thread
+ * calling wait also runs tasks until all of them are done.
+ */
+class ThreadPool {
+private:
+	struct Task {
+		void (*func)(void*);
+		void *cls;
+	};
+	struct Queue {
+		std::mutex lock;
+		std::deque<Task> tasks;
+	};
+	Queue *queues;
+	int num_queues;
+	std::vector<std::thread> threads;
+
+	std::atomic<int> num_queued;	// tasks in the queues
+	std::atomic<int> num_pending;	// tasks added but not finished
+	std::atomic<unsigned int> next_queue;
+	bool quit;
+
+	std::mutex wake_lock;
+	std::condition_variable wake_cond;	// signalled when tasks are added
+	std::condition_variable done_cond;	// signalled when the last task finishes
+
+	ThreadPool(const ThreadPool&);
+	ThreadPool &operator =(const ThreadPool&);
+
+	void worker(int idx);
+	bool get_task(int idx, Task *task);
+	void run_task(const Task &task);
+
+public:
+	// num_threads = 0 creates as many threads as there are processors
+	explicit ThreadPool(int num_threads = 0);
+	~ThreadPool();
+
+	int get_num_threads() const;
+
+	void add_task(void (*func)(void*), void *cls);
+	/* wait for all tasks to finish, running tasks in the meantime.
+	 * NOTE: must not be called from a task, which would wait for itself.
+	 */
+	void wait();
+
+	/* call func(i, cls) for every i in [0, count), in tasks of up to grain
+	 * iterations, and wait for all tasks to finish (same caveat as wait).
+	 */
+	void parallel_for(int count, void (*func)(int, void*), void *cls, int grain = 1);
+};
+
+#endif	// THREADPOOL_H_
@@ -0,0 +1,309 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* curve evaluation benchmarks. Run without arguments to run all of them, or
+ * pass the names of the ones to run. Build in release mode.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include "curve.h"
+#include "chunkarray.h"
+#include "threadpool.h"
+#include "scenetess.h"
+
+static double get_time()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static float frand()
+{
+	return (float)rand() / (float)RAND_MAX;
+}
+
+static Curve *random_curve(CurveType type, int num_cp, bool rational = false)
+{
+	Curve *curve = new Curve(type);
+	for(int i=0; i<num_cp; i++) {
+		Vector2 p = Vector2((float)i / (float)num_cp, frand());
+		curve->add_point(p, rational ? 0.5f + frand() : 1.0f);
+	}
+	return curve;
+}
+
+#define REPEAT	3	// every measurement is the best of REPEAT runs
+
+// keeps the compiler from dropping the results
+static volatile float sink;
+
+static void report(const char *name, int count, double sec, double base_sec = 0.0)
+{
+	printf("  %-28s %8.3f ms  %8.2f Mpoints/s", name, sec * 1e3, count / sec * 1e-6);
+	if(base_sec > 0.0) {
+		printf("  x%.2f", base_sec / sec);
+	}
+	putchar('\n');
+}
+
+// tessellate against the equivalent interpolate loop, on a long curve
+static void bench_tessellate()
+{
+	const int num_cp = 50000;
+	Curve *curve = random_curve(CURVE_HERMITE, num_cp);
+	curve->prepare();
+	printf("hermite curve, %d points\n", num_cp);
+
+	for(int samples=num_cp; samples<=num_cp * 16; samples*=4) {
+		std::vector<Vector3> a(samples), b(samples);
+		std::vector<Vector2> b2(samples);
+
+		double base = 1e10, dur = 1e10, dur2 = 1e10;
+		for(int rep=0; rep<REPEAT; rep++) {
+			double t0 = get_time();
+			for(int i=0; i<samples; i++) {
+				a[i] = curve->interpolate((float)i / (float)(samples - 1));
+			}
+			double t1 = get_time();
+			curve->tessellate(samples, &b[0]);
+			double t2 = get_time();
+			curve->tessellate2(samples, &b2[0]);
+			double t3 = get_time();
+
+			base = std::min(base, t1 - t0);
+			dur = std::min(dur, t2 - t1);
+			dur2 = std::min(dur2, t3 - t2);
+		}
+
+		bool same = memcmp(&a[0], &b[0], samples * sizeof a[0]) == 0;
+		printf(" %d samples (%s output)\n", samples, same ? "identical" : "DIFFERENT");
+		report("interpolate loop", samples, base);
+		report("tessellate", samples, dur, base);
+		report("tessellate2", samples, dur2, base);
+		sink = b2[samples / 2].x;
+	}
+	delete curve;
+}
+
+/* per curve type: the interpolate loop, which finds the segment and tests
+ * for weights on every sample, against tessellate, which selects an evaluator
+ * specialized for the type once per curve. Also shows the adaptive
+ * tessellation, which for polylines just copies the control points.
+ */
+static void bench_dispatch()
+{
+	static const char *type_name[] = {"polyline", "hermite", "b-spline", "rational b-spline"};
+	const int num_cp = 10000, samples = 200000;
+	const float tol = 1e-3f;
+
+	std::vector<Vector3> a(samples), b(samples);
+	std::vector<Vector3> tess;
+
+	for(int i=0; i<4; i++) {
+		Curve *curve = random_curve(i < 3 ? (CurveType)i : CURVE_BSPLINE, num_cp, i == 3);
+		curve->prepare();
+		printf("%s, %d points, %d samples\n", type_name[i], num_cp, samples);
+
+		double base = 1e10, dur = 1e10, adur = 1e10;
+		for(int rep=0; rep<REPEAT; rep++) {
+			double t0 = get_time();
+			for(int j=0; j<samples; j++) {
+				a[j] = curve->interpolate((float)j / (float)(samples - 1));
+			}
+			double t1 = get_time();
+			curve->tessellate(samples, &b[0]);
+			double t2 = get_time();
+			tess.clear();
+			curve->tessellate_adaptive(tol, &tess);
+			double t3 = get_time();
+
+			base = std::min(base, t1 - t0);
+			dur = std::min(dur, t2 - t1);
+			adur = std::min(adur, t3 - t2);
+		}
+		report("interpolate loop", samples, base);
+		report("tessellate", samples, dur, base);
+
+		char name[64];
+		sprintf(name, "adaptive (%d verts)", (int)tess.size());
+		report(name, (int)tess.size(), adur);
+		sink = b[samples / 2].x;
+		delete curve;
+	}
+}
+
+// whole scene adaptive tessellation, serial and on 1 to N threads
+static void bench_scene()
+{
+	const int num_short = 20000, num_long = 4;
+	const float tol = 1e-3f;
+
+	std::vector<Curve*> curves;
+	for(int i=0; i<num_short; i++) {
+		curves.push_back(random_curve(i & 1 ? CURVE_BSPLINE : CURVE_HERMITE, 16));
+	}
+	for(int i=0; i<num_long; i++) {
+		curves.push_back(random_curve(CURVE_HERMITE, 50000));
+	}
+	int count = (int)curves.size();
+	for(int i=0; i<count; i++) {
+		curves[i]->prepare();
+	}
+	printf("%d curves of 16 points, %d of 50000 points, tolerance %g\n", num_short,
+			num_long, tol);
+
+	std::vector<std::vector<Vector3> > ref(count), res(count);
+	double base = 1e10;
+	for(int rep=0; rep<REPEAT; rep++) {
+		double t0 = get_time();
+		tessellate_scene(0, &curves[0], count, tol, &ref[0]);
+		base = std::min(base, get_time() - t0);
+	}
+	int num_verts = 0;
+	for(int i=0; i<count; i++) {
+		num_verts += (int)ref[i].size();
+	}
+	report("serial", num_verts, base);
+
+	// powers of two up to the number of cores (at least 4)
+	int max_threads = std::max((int)std::thread::hardware_concurrency(), 4);
+	for(int nthr=1; ; nthr=std::min(nthr * 2, max_threads)) {
+		ThreadPool pool(nthr);
+		double dur = 1e10;
+		for(int rep=0; rep<REPEAT; rep++) {
+			double t0 = get_time();
+			tessellate_scene(&pool, &curves[0], count, tol, &res[0]);
+			dur = std::min(dur, get_time() - t0);
+		}
+
+		bool same = true;
+		for(int i=0; i<count && same; i++) {
+			same = res[i].size() == ref[i].size() &&
+				memcmp(&res[i][0], &ref[i][0], res[i].size() * sizeof(Vector3)) == 0;
+		}
+		char name[64];
+		sprintf(name, "%d threads%s", nthr, same ? "" : " (DIFFERENT)");
+		report(name, num_verts, dur, base);
+
+		if(nthr == max_threads) break;
+	}
+
+	for(int i=0; i<count; i++) {
+		delete curves[i];
+	}
+}
+
+// interpolate_batch: each code path against per-point interpolate
+static void bench_batch()
+{
+	static const char *mode_name[] = {"auto", "scalar", "sse2", "avx2"};
+	const int count = 1 << 20;
+
+	std::vector<float> t(count), x(count), y(count), z(count);
+	for(int i=0; i<count; i++) {
+		t[i] = frand();
+	}
+
+	for(int rational=0; rational<2; rational++) {
+		Curve *curve = random_curve(CURVE_BSPLINE, 1000, rational);
+		curve->prepare();
+		printf("%s b-spline, 1000 points, %d random parameters\n",
+				rational ? "rational" : "polynomial", count);
+
+		double base = 1e10;
+		for(int rep=0; rep<REPEAT; rep++) {
+			double t0 = get_time();
+			for(int i=0; i<count; i++) {
+				Vector3 v = curve->interpolate(t[i]);
+				x[i] = v.x;
+				y[i] = v.y;
+				z[i] = v.z;
+			}
+			base = std::min(base, get_time() - t0);
+		}
+		report("interpolate", count, base);
+
+		for(int mode=BATCH_SCALAR; mode<=BATCH_AVX2; mode++) {
+			Curve::set_batch_mode((BatchMode)mode);
+			double dur = 1e10;
+			for(int rep=0; rep<REPEAT; rep++) {
+				double t0 = get_time();
+				curve->interpolate_batch(&t[0], count, &x[0], &y[0], &z[0]);
+				dur = std::min(dur, get_time() - t0);
+			}
+			char name[64];
+			sprintf(name, "interpolate_batch (%s)", mode_name[mode]);
+			report(name, count, dur, base);
+		}
+		Curve::set_batch_mode(BATCH_AUTO);
+		sink = x[count / 2];
+		delete curve;
+	}
+}
+
+/* memory used by the control point storage of curves, built with
+ * add_point, per control point
+ */
+static void bench_memory()
+{
+	static const int sizes[] = {2, 16, 100, 1000, 50000};
+	printf("control point storage, %d bytes per point of data\n", (int)sizeof(Vector4));
+
+	for(int i=0; i<(int)(sizeof sizes / sizeof *sizes); i++) {
+		ChunkArray<Vector4> cp;
+		for(int j=0; j<sizes[i]; j++) {
+			cp.push_back(Vector4(frand(), frand(), 0, 1));
+		}
+		size_t bytes = cp.mem_usage();
+		printf("  %6d points: %8d bytes, %6.1f bytes/point\n", sizes[i], (int)bytes,
+				(double)bytes / sizes[i]);
+	}
+}
+
+static struct {
+	const char *name;
+	void (*func)();
+} benchmarks[] = {
+	{"tessellate", bench_tessellate},
+	{"dispatch", bench_dispatch},
+	{"scene", bench_scene},
+	{"batch", bench_batch},
+	{"memory", bench_memory},
+	{0, 0}
+};
+
+int main(int argc, char **argv)
+{
+	for(int i=0; benchmarks[i].name; i++) {
+		bool run = argc <= 1;
+		for(int j=1; j<argc; j++) {
+			if(strcmp(argv[j], benchmarks[i].name) == 0) {
+				run = true;
+			}
+		}
+		if(run) {
+			printf("-- %s --\n", benchmarks[i].name);
+			benchmarks[i].func();
+		}
+	}
+	return 0;
+}
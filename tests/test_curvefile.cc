@@ -0,0 +1,191 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* round trips curves and rational nurbs curves through the text and binary
+ * formats, and checks that the values read back are bit-exact, and that
+ * converting text -> binary -> text and binary -> text -> binary reproduces
+ * the same files.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "curvefile.h"
+#include "curvebin.h"
+
+#define TEXT_FILE	"test_roundtrip.curves"
+#define TEXT_FILE2	"test_roundtrip2.curves"
+#define BIN_FILE	"test_roundtrip.curvesb"
+#define BIN_FILE2	"test_roundtrip2.curvesb"
+
+struct Scene {
+	std::vector<Curve*> curves;
+	std::vector<Nurbs*> nurbs;
+
+	~Scene()
+	{
+		for(size_t i=0; i<curves.size(); i++) delete curves[i];
+		for(size_t i=0; i<nurbs.size(); i++) delete nurbs[i];
+	}
+};
+
+static float frand()
+{
+	return (float)rand() / (float)RAND_MAX;
+}
+
+static bool same_bits(const void *a, const void *b, size_t size)
+{
+	return memcmp(a, b, size) == 0;
+}
+
+static void make_scene(Scene *scn)
+{
+	for(int i=0; i<6; i++) {
+		Curve *curve = new Curve((CurveType)(i % 3));
+		int num_cp = 2 + rand() % 20;
+		for(int j=0; j<num_cp; j++) {
+			Vector3 p = Vector3(frand(), frand(), frand()) * 20.0f - Vector3(10, 10, 10);
+			curve->add_point(p, i >= 3 ? 0.1f + frand() * 3.0f : 1.0f);
+		}
+		scn->curves.push_back(curve);
+	}
+
+	// rational nurbs with arbitrary knots and weights
+	for(int i=0; i<4; i++) {
+		int degree = 1 + i;
+		int num_cp = degree + 1 + rand() % 10;
+		std::vector<float> knots(num_cp + degree + 1);
+		knots[0] = frand();
+		for(size_t j=1; j<knots.size(); j++) {
+			knots[j] = knots[j - 1] + (rand() % 4 ? frand() : 0.0f);
+		}
+		std::vector<Vector4> cp(num_cp);
+		for(int j=0; j<num_cp; j++) {
+			cp[j] = Vector4(frand() * 7.0f, frand() * 3.0f, frand(), 0.1f + frand() * 5.0f);
+		}
+
+		Nurbs *nurbs = new Nurbs;
+		nurbs->set(degree, &knots[0], (int)knots.size(), &cp[0], num_cp);
+		nurbs->refine_uniform(2);
+		scn->nurbs.push_back(nurbs);
+	}
+
+	// and one converted from a rational b-spline
+	Nurbs *nurbs = new Nurbs;
+	nurbs->set(*scn->curves[5]);
+	scn->nurbs.push_back(nurbs);
+}
+
+static bool same_scene(const Scene &a, const Scene &b, const char *what)
+{
+	bool res = a.curves.size() == b.curves.size() && a.nurbs.size() == b.nurbs.size();
+
+	for(size_t i=0; res && i<a.curves.size(); i++) {
+		const Curve *ca = a.curves[i], *cb = b.curves[i];
+		res = ca->get_type() == cb->get_type() && ca->size() == cb->size();
+		for(int j=0; res && j<ca->size(); j++) {
+			res = same_bits(&ca->get_point(j), &cb->get_point(j), sizeof(Vector4));
+		}
+	}
+
+	for(size_t i=0; res && i<a.nurbs.size(); i++) {
+		const Nurbs *na = a.nurbs[i], *nb = b.nurbs[i];
+		res = na->get_degree() == nb->get_degree() && na->size() == nb->size() &&
+			na->num_knots() == nb->num_knots();
+		for(int j=0; res && j<na->num_knots(); j++) {
+			float ka = na->get_knot(j), kb = nb->get_knot(j);
+			res = same_bits(&ka, &kb, sizeof ka);
+		}
+		for(int j=0; res && j<na->size(); j++) {
+			res = same_bits(&na->get_homog_point(j), &nb->get_homog_point(j), sizeof(Vector4));
+		}
+	}
+
+	if(!res) {
+		fprintf(stderr, "%s: curves differ\n", what);
+	}
+	return res;
+}
+
+static bool save(const char *fname, const Scene &scn, bool binary)
+{
+	const Curve * const *cptr = scn.curves.empty() ? 0 : &scn.curves[0];
+	const Nurbs * const *nptr = scn.nurbs.empty() ? 0 : &scn.nurbs[0];
+	if(binary) {
+		return save_curves_bin(fname, cptr, (int)scn.curves.size(), nptr, (int)scn.nurbs.size());
+	}
+	return save_curves(fname, cptr, (int)scn.curves.size(), nptr, (int)scn.nurbs.size());
+}
+
+static bool load(const char *fname, Scene *scn)
+{
+	std::list<Nurbs*> nlist;
+	std::list<Curve*> clist = load_curves(fname, &nlist);
+	scn->curves.assign(clist.begin(), clist.end());
+	scn->nurbs.assign(nlist.begin(), nlist.end());
+	return !clist.empty();
+}
+
+static bool same_files(const char *fname1, const char *fname2)
+{
+	FILE *fp1 = fopen(fname1, "rb");
+	FILE *fp2 = fopen(fname2, "rb");
+	bool res = fp1 && fp2;
+
+	while(res) {
+		int c1 = fgetc(fp1);
+		int c2 = fgetc(fp2);
+		res = c1 == c2;
+		if(c1 == EOF) break;
+	}
+	if(fp1) fclose(fp1);
+	if(fp2) fclose(fp2);
+
+	if(!res) {
+		fprintf(stderr, "%s and %s differ\n", fname1, fname2);
+	}
+	return res;
+}
+
+int main()
+{
+	Scene orig, text, bin, text2, bin2;
+	make_scene(&orig);
+
+	bool res = save(TEXT_FILE, orig, false) && load(TEXT_FILE, &text) &&
+		save(BIN_FILE, text, true) && load(BIN_FILE, &bin) &&
+		save(TEXT_FILE2, bin, false) && load(TEXT_FILE2, &text2) &&
+		save(BIN_FILE2, text2, true) && load(BIN_FILE2, &bin2);
+	if(!res) {
+		fprintf(stderr, "failed to save or load the test files\n");
+		return 1;
+	}
+
+	res = same_scene(orig, text, "text") & same_scene(orig, bin, "text -> binary") &
+		same_scene(orig, text2, "text -> binary -> text") &
+		same_scene(orig, bin2, "binary -> text -> binary") &
+		same_files(TEXT_FILE, TEXT_FILE2) & same_files(BIN_FILE, BIN_FILE2);
+
+	remove(TEXT_FILE);
+	remove(TEXT_FILE2);
+	remove(BIN_FILE);
+	remove(BIN_FILE2);
+
+	printf("curve file round trip: %s\n", res ? "ok" : "FAILED");
+	return res ? 0 : 1;
+}
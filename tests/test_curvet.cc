@@ -0,0 +1,174 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* checks CurveT in float and double, 2D and 3D, with and without weights,
+ * against Curve::interpolate for all curve types: interpolate and tessellate
+ * after from_curve, and the control points after to_curve. Also checks that
+ * from_curve refuses weighted b-splines without Rational.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include "curvet.h"
+
+#define TOL		1e-4f
+#define NUM_SAMPLES	57
+
+static const char *type_name[] = {"polyline", "hermite", "bspline"};
+
+static float frand()
+{
+	return (float)rand() / (float)RAND_MAX;
+}
+
+static bool check(const char *desc, const char *what, float t, const Vector3 &v,
+		const double *res, int dim)
+{
+	float err = 0.0f;
+	for(int i=0; i<dim; i++) {
+		err = std::max(err, (float)fabs(v[i] - res[i]));
+	}
+	if(!(err <= TOL)) {
+		fprintf(stderr, "%s, %s: t=%g expected (%g %g %g) got (%g %g %g)\n", desc, what, t,
+				v.x, v.y, v.z, res[0], res[1], dim > 2 ? res[2] : 0.0);
+		return false;
+	}
+	return true;
+}
+
+template <typename Scalar, int Dim, bool Rational>
+static int test_curve(const Curve &curve, const char *cdesc)
+{
+	char desc[128];
+	sprintf(desc, "CurveT<%s, %d%s> %s", sizeof(Scalar) == sizeof(float) ? "float" : "double",
+			Dim, Rational ? ", rational" : "", cdesc);
+
+	CurveT<Scalar, Dim, Rational> ct;
+	if(!ct.from_curve(curve)) {
+		fprintf(stderr, "%s: from_curve failed\n", desc);
+		return 1;
+	}
+	if(ct.size() != curve.size() || ct.get_type() != curve.get_type()) {
+		fprintf(stderr, "%s: from_curve gave %d points\n", desc, ct.size());
+		return 1;
+	}
+
+	int fail = 0;
+	Scalar res[Dim];
+	double dres[3];
+
+	// on, next to and outside the segment boundaries, and in between
+	int num_cp = curve.size();
+	std::vector<float> tv;
+	for(int i=0; i<num_cp; i++) {
+		float t = num_cp > 1 ? (float)i / (float)(num_cp - 1) : 0.0f;
+		tv.push_back(t);
+		tv.push_back(nextafterf(t, -1.0f));
+		tv.push_back(nextafterf(t, 2.0f));
+	}
+	tv.push_back(-0.5f);
+	tv.push_back(1.5f);
+	for(int i=0; i<50; i++) {
+		tv.push_back(frand());
+	}
+
+	for(size_t i=0; i<tv.size(); i++) {
+		ct.interpolate((Scalar)tv[i], res);
+		for(int j=0; j<Dim; j++) dres[j] = res[j];
+		if(!check(desc, "interpolate", tv[i], curve.interpolate(tv[i]), dres, Dim)) {
+			++fail;
+		}
+	}
+
+	Scalar tess[NUM_SAMPLES * Dim];
+	ct.tessellate(NUM_SAMPLES, tess);
+	for(int i=0; i<NUM_SAMPLES; i++) {
+		float t = (float)i / (float)(NUM_SAMPLES - 1);
+		for(int j=0; j<Dim; j++) dres[j] = tess[i * Dim + j];
+		if(!check(desc, "tessellate", t, curve.interpolate(t), dres, Dim)) {
+			++fail;
+		}
+	}
+
+	// coordinates past Dim become 0, and weights 1 without Rational
+	Curve back;
+	ct.to_curve(&back);
+	if(back.size() != num_cp || back.get_type() != curve.get_type()) {
+		fprintf(stderr, "%s: to_curve gave %d points\n", desc, back.size());
+		return fail + 1;
+	}
+	for(int i=0; i<num_cp; i++) {
+		Vector4 a = curve.get_point(i);
+		const Vector4 &b = back.get_point(i);
+		for(int j=Dim; j<3; j++) a[j] = 0.0f;
+		if(!Rational) a.w = 1.0f;
+
+		if(fabs(a.x - b.x) > TOL || fabs(a.y - b.y) > TOL || fabs(a.z - b.z) > TOL ||
+				fabs(a.w - b.w) > TOL) {
+			fprintf(stderr, "%s: to_curve point %d is (%g %g %g %g) instead of (%g %g %g %g)\n",
+					desc, i, b.x, b.y, b.z, b.w, a.x, a.y, a.z, a.w);
+			++fail;
+		}
+	}
+	return fail;
+}
+
+int main()
+{
+	int fail = 0;
+	for(int type=CURVE_LINEAR; type<=CURVE_BSPLINE; type++) {
+		for(int rational=0; rational<2; rational++) {
+			static const int sizes[] = {1, 2, 3, 13};
+			for(int k=0; k<4; k++) {
+				int num_cp = sizes[k];
+				Curve curve((CurveType)type);
+				for(int i=0; i<num_cp; i++) {
+					Vector3 p = Vector3(frand(), frand(), frand()) * 4.0f - Vector3(2, 2, 2);
+					curve.add_point(p, rational ? 0.25f + frand() * 2.0f : 1.0f);
+				}
+
+				char desc[64];
+				sprintf(desc, "%s%s with %d points", rational ? "weighted " : "",
+						type_name[type], num_cp);
+
+				fail += test_curve<float, 2, true>(curve, desc);
+				fail += test_curve<double, 2, true>(curve, desc);
+				fail += test_curve<float, 3, true>(curve, desc);
+				fail += test_curve<double, 3, true>(curve, desc);
+
+				// without Rational, only curves which don't depend on the weights
+				bool weighted = rational && type == CURVE_BSPLINE && num_cp > 2;
+				if(!weighted) {
+					fail += test_curve<float, 2, false>(curve, desc);
+					fail += test_curve<double, 2, false>(curve, desc);
+					fail += test_curve<float, 3, false>(curve, desc);
+					fail += test_curve<double, 3, false>(curve, desc);
+				} else {
+					Curve3f ct;
+					if(ct.from_curve(curve) || !ct.empty()) {
+						fprintf(stderr, "Curve3f accepted a %s\n", desc);
+						++fail;
+					}
+				}
+			}
+		}
+	}
+
+	printf("CurveT: %d mismatches\n", fail);
+	return fail ? 1 : 0;
+}
@@ -0,0 +1,298 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* checks the intersection queries against known answers: crossing hermite
+ * curves (one crossing on a control point shared by two segments of each,
+ * which must be merged), a b-spline against a line, the self intersection of
+ * a figure eight and of a curve without any, and a whole scene with and
+ * without a given bvh.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include "intersect.h"
+
+#define TOL			1e-4f
+#define PARAM_TOL	1e-3f
+
+static int fail;
+
+static void expect(bool cond, const char *test, const char *what)
+{
+	if(!cond) {
+		fprintf(stderr, "%s: %s\n", test, what);
+		++fail;
+	}
+}
+
+/* every hit must be on both curves, at its parameters, and in order of ta
+ * among the hits of the same pair of curves
+ */
+static void check_hits(const char *test, const std::vector<CurveIsect> &hits,
+		const Vector3 &p0 = Vector3(0, 0, 0), const Vector3 &p1 = Vector3(0, 0, 0))
+{
+	for(size_t i=0; i<hits.size(); i++) {
+		const CurveIsect &h = hits[i];
+		Vector3 pa = h.a->interpolate(h.ta);
+		Vector3 pb = h.b ? h.b->interpolate(h.tb) : p0 + (p1 - p0) * h.tb;
+		if((pa - h.pos).length() > TOL || (pb - h.pos).length() > TOL) {
+			fprintf(stderr, "%s: hit %d at (%g %g) is not on the curves (%g %g) (%g %g)\n",
+					test, (int)i, h.pos.x, h.pos.y, pa.x, pa.y, pb.x, pb.y);
+			++fail;
+		}
+		const CurveIsect &prev = hits[i > 0 ? i - 1 : 0];
+		if(i > 0 && prev.a == h.a && prev.b == h.b && h.ta < prev.ta) {
+			fprintf(stderr, "%s: hits not in order of ta\n", test);
+			++fail;
+		}
+	}
+}
+
+static Curve *make_curve(CurveType type, const Vector2 *pt, int count)
+{
+	Curve *curve = new Curve(type);
+	for(int i=0; i<count; i++) {
+		curve->add_point(pt[i]);
+	}
+	return curve;
+}
+
+// y = x and y = -x, crossing at the middle control point of both
+static void test_crossing()
+{
+	const char *test = "crossing diagonals";
+	static const Vector2 pa[] = {Vector2(-1, -1), Vector2(0, 0), Vector2(1, 1)};
+	static const Vector2 pb[] = {Vector2(-1, 1), Vector2(0, 0), Vector2(1, -1)};
+	Curve *a = make_curve(CURVE_HERMITE, pa, 3);
+	Curve *b = make_curve(CURVE_HERMITE, pb, 3);
+
+	std::vector<CurveIsect> hits;
+	int n = intersect_curves(a, b, TOL, &hits);
+	check_hits(test, hits);
+	expect(n == 1 && hits.size() == 1, test, "expected 1 hit");
+	if(n == 1) {
+		expect(hits[0].a == a && hits[0].b == b, test, "wrong curves");
+		expect(fabs(hits[0].ta - 0.5f) < PARAM_TOL && fabs(hits[0].tb - 0.5f) < PARAM_TOL,
+				test, "expected ta = tb = 0.5");
+		expect(hits[0].pos.length() < TOL, test, "expected the hit at the origin");
+	}
+	delete a;
+	delete b;
+}
+
+/* an arch through (-1, 0), (0, 1), (1, 0) crosses y = 0.5 symmetrically.
+ * With the coarse tolerance, subdivision stops at parts whose chords miss
+ * the curves by far more than TOL, and the newton refinement has to get
+ * the hits onto both curves.
+ */
+static void test_arch()
+{
+	static const Vector2 pa[] = {Vector2(-1, 0), Vector2(0, 1), Vector2(1, 0)};
+	static const Vector2 pb[] = {Vector2(-2, 0.5), Vector2(2, 0.5)};
+	Curve *a = make_curve(CURVE_HERMITE, pa, 3);
+	Curve *b = make_curve(CURVE_HERMITE, pb, 2);
+
+	for(int coarse=0; coarse<2; coarse++) {
+		const char *test = coarse ? "arch and line, coarse" : "arch and line";
+
+		std::vector<CurveIsect> hits;
+		int n = intersect_curves(a, b, coarse ? 0.1f : TOL, &hits);
+		check_hits(test, hits);
+		expect(n == 2, test, "expected 2 hits");
+		if(n == 2) {
+			expect(fabs(hits[0].ta + hits[1].ta - 1.0f) < PARAM_TOL, test, "ta not symmetric");
+			expect(fabs(hits[0].pos.x + hits[1].pos.x) < TOL, test, "x not symmetric");
+			expect(fabs(hits[0].pos.y - 0.5f) < TOL, test, "expected y = 0.5");
+			expect(fabs(hits[0].tb - (hits[0].pos.x + 2.0f) / 4.0f) < PARAM_TOL, test,
+					"wrong tb");
+		}
+	}
+	delete a;
+	delete b;
+}
+
+/* a zigzag b-spline against y = 0: the answer is found by bisection on the
+ * sign changes of y along the curve
+ */
+static void test_line()
+{
+	const char *test = "b-spline and line";
+	static const Vector2 pt[] = {Vector2(0, -1), Vector2(1, 1), Vector2(2, -1), Vector2(3, 1),
+		Vector2(4, -1), Vector2(5, 1)};
+	Curve *curve = make_curve(CURVE_BSPLINE, pt, 6);
+
+	std::vector<float> ref;
+	const int samples = 10000;
+	for(int i=0; i<samples; i++) {
+		float t0 = (float)i / (float)samples;
+		float t1 = (float)(i + 1) / (float)samples;
+		if((curve->interpolate(t0).y < 0.0f) == (curve->interpolate(t1).y < 0.0f)) {
+			continue;
+		}
+		for(int j=0; j<30; j++) {
+			float mid = (t0 + t1) * 0.5f;
+			if((curve->interpolate(mid).y < 0.0f) == (curve->interpolate(t0).y < 0.0f)) {
+				t0 = mid;
+			} else {
+				t1 = mid;
+			}
+		}
+		ref.push_back((t0 + t1) * 0.5f);
+	}
+
+	Vector3 p0 = Vector3(-1, 0, 0), p1 = Vector3(6, 0, 0);
+	std::vector<CurveIsect> hits;
+	int n = intersect_line(curve, p0, p1, TOL, &hits);
+	check_hits(test, hits, p0, p1);
+	expect(ref.size() == 5, test, "expected 5 crossings of the reference");
+	expect(n == (int)ref.size(), test, "wrong number of hits");
+	for(int i=0; i<n && i<(int)ref.size(); i++) {
+		expect(hits[i].b == 0, test, "line hits must have a null b");
+		if(fabs(hits[i].ta - ref[i]) > PARAM_TOL) {
+			fprintf(stderr, "%s: hit %d at t=%g instead of %g\n", test, i, hits[i].ta, ref[i]);
+			++fail;
+		}
+	}
+	delete curve;
+}
+
+/* figure eight through samples of x = cos s, y = sin s cos s, from s = pi/4
+ * to 7pi/4. It crosses itself at the origin, at s = pi/2 and 3pi/2, which
+ * are the control points 1 and 5 of 6.
+ */
+static Curve *figure_eight(const Vector2 &offs)
+{
+	Curve *curve = new Curve(CURVE_HERMITE);
+	for(int i=0; i<7; i++) {
+		float s = (float)(M_PI / 4.0 * (i + 1));
+		curve->add_point(Vector2(cos(s), sin(s) * cos(s)) + offs);
+	}
+	return curve;
+}
+
+static void test_self()
+{
+	const char *test = "figure eight";
+	Curve *curve = figure_eight(Vector2(0, 0));
+
+	std::vector<CurveIsect> hits;
+	int n = intersect_self(curve, TOL, &hits);
+	check_hits(test, hits);
+	expect(n == 1, test, "expected 1 self intersection");
+	if(n == 1) {
+		expect(hits[0].a == curve && hits[0].b == curve, test, "wrong curves");
+		expect(fabs(hits[0].ta - 1.0f / 6.0f) < PARAM_TOL &&
+				fabs(hits[0].tb - 5.0f / 6.0f) < PARAM_TOL, test,
+				"expected ta = 1/6, tb = 5/6");
+		expect(hits[0].pos.length() < TOL, test, "expected the hit at the origin");
+	}
+
+	// the same through intersect_curves
+	hits.clear();
+	expect(intersect_curves(curve, curve, TOL, &hits) == 1, test,
+			"intersect_curves(c, c) differs from intersect_self");
+	delete curve;
+
+	// the ends of consecutive segments are not intersections
+	test = "no self intersection";
+	static const Vector2 pt[] = {Vector2(0, 0), Vector2(1, 1), Vector2(2, 0), Vector2(3, 1),
+		Vector2(4, 0)};
+	for(int type=CURVE_LINEAR; type<=CURVE_BSPLINE; type++) {
+		curve = make_curve((CurveType)type, pt, 5);
+		hits.clear();
+		expect(intersect_self(curve, TOL, &hits) == 0, test, "expected no hits");
+		delete curve;
+	}
+}
+
+// number of hits between curves a and b (in either order)
+static int count_pair(const std::vector<CurveIsect> &hits, const Curve *a, const Curve *b)
+{
+	int count = 0;
+	for(size_t i=0; i<hits.size(); i++) {
+		if((hits[i].a == a && hits[i].b == b) || (hits[i].a == b && hits[i].b == a)) {
+			++count;
+		}
+	}
+	return count;
+}
+
+/* the arch and its line, the diagonals, a figure eight away from the rest,
+ * and an extra curve over the arch, which is only in the bvh
+ */
+static void test_scene()
+{
+	const char *test = "scene";
+	static const Vector2 arch[] = {Vector2(-1, 0), Vector2(0, 1), Vector2(1, 0)};
+	static const Vector2 line[] = {Vector2(-2, 0.5), Vector2(2, 0.5)};
+	static const Vector2 diag1[] = {Vector2(9, -1), Vector2(10, 0), Vector2(11, 1)};
+	static const Vector2 diag2[] = {Vector2(9, 1), Vector2(10, 0), Vector2(11, -1)};
+	static const Vector2 extra[] = {Vector2(0, -1), Vector2(0, 2)};
+
+	Curve *curves[] = {
+		make_curve(CURVE_HERMITE, arch, 3),
+		make_curve(CURVE_LINEAR, line, 2),
+		make_curve(CURVE_HERMITE, diag1, 3),
+		make_curve(CURVE_HERMITE, diag2, 3),
+		figure_eight(Vector2(0, 10))
+	};
+	const int count = sizeof curves / sizeof *curves;
+	Curve *other = make_curve(CURVE_LINEAR, extra, 2);
+
+	CurveBVH bvh;
+	bvh.build(curves, count);
+	bvh.add(other);
+
+	for(int pass=0; pass<2; pass++) {
+		const CurveBVH *use_bvh = pass ? &bvh : 0;
+		char desc[64];
+
+		for(int self=0; self<2; self++) {
+			sprintf(desc, "%s (%s bvh, %s self intersections)", test, pass ? "given" : "no",
+					self ? "with" : "without");
+
+			std::vector<CurveIsect> hits;
+			int n = intersect_scene(use_bvh, curves, count, TOL, self, &hits);
+			check_hits(desc, hits);
+			expect(n == (int)hits.size(), desc, "wrong return value");
+			expect(n == 3 + self, desc, "wrong number of hits");
+			expect(count_pair(hits, curves[0], curves[1]) == 2, desc, "expected 2 arch hits");
+			expect(count_pair(hits, curves[2], curves[3]) == 1, desc,
+					"expected 1 diagonal hit");
+			expect(count_pair(hits, curves[4], curves[4]) == self, desc,
+					"wrong figure eight self hits");
+		}
+	}
+
+	for(int i=0; i<count; i++) {
+		delete curves[i];
+	}
+	delete other;
+}
+
+int main()
+{
+	test_crossing();
+	test_arch();
+	test_line();
+	test_self();
+	test_scene();
+
+	printf("intersect: %d failures\n", fail);
+	return fail ? 1 : 0;
+}
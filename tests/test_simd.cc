@@ -0,0 +1,120 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* checks every interpolate_batch code path against interpolate, for all curve
+ * types, with and without weights, at counts which aren't multiples of the
+ * vector width, and at parameters on, next to and outside segment boundaries.
+ * Paths not supported by the processor fall back to the next one.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <vector>
+#include "curve.h"
+
+#define TOL		1e-4f
+
+static const char *mode_name[] = {"auto", "scalar", "sse2", "avx2"};
+static const char *type_name[] = {"polyline", "hermite", "bspline"};
+
+static float frand()
+{
+	return (float)rand() / (float)RAND_MAX;
+}
+
+// parameters to test with a curve of num_cp control points
+static void make_params(int num_cp, std::vector<float> *tv)
+{
+	tv->clear();
+	for(int i=0; i<num_cp; i++) {
+		float t = (float)i / (float)(num_cp - 1);
+		tv->push_back(t);
+		tv->push_back(nextafterf(t, -1.0f));
+		tv->push_back(nextafterf(t, 2.0f));
+	}
+	tv->push_back(-0.5f);
+	tv->push_back(1.5f);
+	for(int i=0; i<200; i++) {
+		tv->push_back(frand());
+	}
+}
+
+static int test_curve(const Curve &curve, const char *desc)
+{
+	std::vector<float> tv;
+	make_params(curve.size(), &tv);
+
+	int total = (int)tv.size();
+	std::vector<float> x(total), y(total), z(total);
+	int fail = 0;
+
+	for(int mode=BATCH_AUTO; mode<=BATCH_AVX2; mode++) {
+		Curve::set_batch_mode((BatchMode)mode);
+
+		// every count up to a few vector widths, starting at various offsets
+		for(int j=0; j<=40; j++) {
+			int count = j < 40 ? j : total;
+			int first = count ? (count * 7) % (total - count + 1) : 0;
+			curve.interpolate_batch(&tv[first], count, &x[0], &y[0], count & 1 ? 0 : &z[0]);
+
+			for(int i=0; i<count; i++) {
+				Vector3 v = curve.interpolate(tv[first + i]);
+				float err = std::max(fabs(v.x - x[i]), fabs(v.y - y[i]));
+				if(!(count & 1)) err = std::max(err, (float)fabs(v.z - z[i]));
+
+				if(!(err <= TOL)) {
+					if(!fail++) {
+						fprintf(stderr, "%s, %s path, count %d: t=%.9g expected (%g %g %g) got (%g %g %g)\n",
+								desc, mode_name[mode], count, tv[first + i], v.x, v.y, v.z,
+								x[i], y[i], count & 1 ? 0.0f : z[i]);
+					}
+				}
+			}
+		}
+	}
+	Curve::set_batch_mode(BATCH_AUTO);
+	return fail;
+}
+
+int main()
+{
+	int fail = 0;
+	for(int type=CURVE_LINEAR; type<=CURVE_BSPLINE; type++) {
+		for(int rational=0; rational<2; rational++) {
+			for(int num_cp=2; num_cp<=13; num_cp += 11) {
+				Curve curve((CurveType)type);
+				for(int i=0; i<num_cp; i++) {
+					Vector3 p = Vector3(frand(), frand(), frand()) * 4.0f - Vector3(2, 2, 2);
+					curve.add_point(p, rational ? 0.25f + frand() * 2.0f : 1.0f);
+				}
+
+				char desc[64];
+				sprintf(desc, "%s%s with %d points", rational ? "rational " : "",
+						type_name[type], num_cp);
+				int res = test_curve(curve, desc);
+				if(res) {
+					fprintf(stderr, "%s: %d mismatches\n", desc, res);
+				}
+				fail += res;
+			}
+		}
+	}
+
+	printf("interpolate_batch: %d mismatches\n", fail);
+	return fail ? 1 : 0;
+}
@@ -0,0 +1,150 @@
+/*
+curvedraw - a simple program to draw curves
+Copyright (C) 2015-2016  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* snapshot stress test, meant to be built with -fsanitize=thread: one thread
+ * keeps editing a curve and publishing snapshots of it, while the others
+ * read the latest snapshot and check it against the values recorded when it
+ * was taken.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include "curvesnapshot.h"
+
+#define NUM_POINTS		2000
+#define NUM_SNAPSHOTS	100
+#define EDITS_PER_SNAP	50
+#define NUM_READERS		3
+#define NUM_SAMPLES		64
+
+struct Published {
+	std::shared_ptr<const CurveSnapshot> snap;
+	std::shared_ptr<const std::vector<Vector4> > points;	// copy of the points
+	float length;
+	Vector3 samples[NUM_SAMPLES];
+};
+
+static std::mutex pub_lock;
+static std::shared_ptr<const Published> pub;
+static std::atomic<bool> done;
+static std::atomic<int> num_errors, num_checks;
+
+static float frand()
+{
+	return (float)rand() / (float)RAND_MAX;
+}
+
+static void editor()
+{
+	Curve curve;
+	for(int i=0; i<NUM_POINTS; i++) {
+		curve.add_point(Vector2(i * 0.01f, frand()));
+	}
+
+	for(int i=0; i<NUM_SNAPSHOTS; i++) {
+		std::shared_ptr<Published> p(new Published);
+		p->snap.reset(new CurveSnapshot(curve));
+		/* read the points through get_point, which leaves the chunks and
+		 * caches of the curve shared with the snapshot
+		 */
+		std::vector<Vector4> points(curve.size());
+		for(int j=0; j<curve.size(); j++) {
+			points[j] = curve.get_point(j);
+		}
+		p->points.reset(new std::vector<Vector4>(std::move(points)));
+		p->length = p->snap->length();
+		p->snap->tessellate(NUM_SAMPLES, p->samples);
+
+		pub_lock.lock();
+		pub = p;
+		pub_lock.unlock();
+
+		// edit the curve while the readers use the snapshot
+		for(int j=0; j<EDITS_PER_SNAP; j++) {
+			int idx = rand() % curve.size();
+			switch(rand() % 4) {
+			case 0:
+				curve.remove_point(idx);
+				break;
+			case 1:
+				curve.add_point(Vector2(frand() * 40.0f, frand()));
+				break;
+			default:
+				curve.move_point(idx, Vector2(curve.get_point2(idx).x, frand()));
+			}
+		}
+		curve.length();	// fill some caches before the next snapshot
+	}
+	done = true;
+}
+
+static void reader(int seed)
+{
+	Vector3 samples[NUM_SAMPLES];
+
+	while(!done) {
+		pub_lock.lock();
+		std::shared_ptr<const Published> p = pub;
+		pub_lock.unlock();
+		if(!p) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		const CurveSnapshot *snap = p->snap.get();
+		const std::vector<Vector4> &points = *p->points;
+		bool ok = snap->size() == (int)points.size() && snap->length() == p->length;
+
+		for(int i=0; i<16 && ok; i++) {
+			int idx = (seed = seed * 1103515245 + 12345) % (int)points.size();
+			if(idx < 0) idx = -idx;
+			const Vector4 &a = snap->get_point(idx);
+			const Vector4 &b = points[idx];
+			ok = a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+		}
+
+		snap->tessellate(NUM_SAMPLES, samples);
+		for(int i=0; i<NUM_SAMPLES && ok; i++) {
+			ok = samples[i].x == p->samples[i].x && samples[i].y == p->samples[i].y;
+		}
+		snap->interpolate_by_length(p->length * 0.5f);
+
+		if(!ok) ++num_errors;
+		++num_checks;
+		std::this_thread::yield();
+	}
+}
+
+int main()
+{
+	std::vector<std::thread> threads;
+	for(int i=0; i<NUM_READERS; i++) {
+		threads.push_back(std::thread(reader, i + 1));
+	}
+	editor();
+	for(int i=0; i<NUM_READERS; i++) {
+		threads[i].join();
+	}
+
+	printf("%d snapshot checks, %d failed\n", (int)num_checks, (int)num_errors);
+	return num_errors ? 1 : 0;
+}